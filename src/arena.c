@@ -0,0 +1,162 @@
+#include "arena.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "raylib.h"
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t size;            // bytes of data after the header
+    size_t used;
+};
+
+struct ArenaDeferred {
+    ArenaDeferred* next;
+    ArenaCleanup cleanup;
+    void* data;
+};
+
+Arena g_screenArena;
+Arena g_frameArena;
+
+static unsigned char* GetBlockData(ArenaBlock* block) {
+    return (unsigned char*)(block + 1);
+}
+
+// Offset of the next aligned allocation in block
+static size_t GetAlignedOffset(ArenaBlock* block) {
+    uintptr_t start = (uintptr_t)GetBlockData(block);
+    uintptr_t next = (start + block->used + ARENA_ALIGNMENT - 1) & ~(uintptr_t)(ARENA_ALIGNMENT - 1);
+    return next - start;
+}
+
+static ArenaBlock* AddArenaBlock(Arena* arena, size_t size) {
+    // slack for the alignment, whatever MemAlloc() returns
+    size = size + ARENA_ALIGNMENT > ARENA_BLOCK_SIZE ? size + ARENA_ALIGNMENT : ARENA_BLOCK_SIZE;
+    ArenaBlock* block = MemAlloc(sizeof(ArenaBlock) + size);
+    block->next = arena->blocks;
+    block->size = size;
+    block->used = 0;
+    arena->blocks = block;
+    return block;
+}
+
+static void SetBlockUsed(Arena* arena, ArenaBlock* block, size_t used) {
+    arena->used = arena->used - block->used + used;
+    block->used = used;
+    if (arena->used > arena->peak) {
+        arena->peak = arena->used;
+    }
+}
+
+void* ArenaAlloc(Arena* arena, size_t size) {
+    ArenaBlock* block = arena->blocks;
+    size_t offset = block != NULL ? GetAlignedOffset(block) : 0;
+    if (block == NULL || offset + size > block->size) {
+        block = AddArenaBlock(arena, size);
+        offset = GetAlignedOffset(block);
+    }
+
+    unsigned char* ptr = GetBlockData(block) + offset;
+    SetBlockUsed(arena, block, offset + size);
+    memset(ptr, 0, size);
+    arena->last = ptr;
+    return ptr;
+}
+
+void* ArenaResize(Arena* arena, void* ptr, size_t oldSize, size_t newSize) {
+    if (ptr == NULL) {
+        return ArenaAlloc(arena, newSize);
+    }
+
+    // the last allocation is always in the first block
+    if (ptr == arena->last) {
+        ArenaBlock* block = arena->blocks;
+        size_t offset = (unsigned char*)ptr - GetBlockData(block);
+        if (offset + newSize <= block->size) {
+            if (newSize > oldSize) {
+                memset((unsigned char*)ptr + oldSize, 0, newSize - oldSize);
+            }
+            SetBlockUsed(arena, block, offset + newSize);
+            return ptr;
+        }
+    }
+    if (newSize <= oldSize) {
+        return ptr;
+    }
+
+    void* moved = ArenaAlloc(arena, newSize);
+    memcpy(moved, ptr, oldSize);
+    return moved;
+}
+
+char* ArenaFormat(Arena* arena, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+
+    char* text = ArenaAlloc(arena, length > 0 ? length + 1 : 1);
+    if (length > 0) {
+        vsnprintf(text, length + 1, format, args);
+    }
+    va_end(args);
+    return text;
+}
+
+void ArenaDefer(Arena* arena, ArenaCleanup cleanup, void* data) {
+    ArenaDeferred* deferred = ArenaAlloc(arena, sizeof(ArenaDeferred));
+    deferred->next = arena->deferred;
+    deferred->cleanup = cleanup;
+    deferred->data = data;
+    arena->deferred = deferred;
+}
+
+static void RunArenaCleanups(Arena* arena) {
+    ArenaDeferred* deferred = arena->deferred;
+    arena->deferred = NULL;
+    for (; deferred != NULL; deferred = deferred->next) {
+        deferred->cleanup(deferred->data);
+    }
+}
+
+static void FreeArenaBlocks(Arena* arena) {
+    ArenaBlock* block = arena->blocks;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        MemFree(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+}
+
+void ResetArena(Arena* arena) {
+    RunArenaCleanups(arena);
+
+    // one block sized for the whole round, so the next one does not spill again
+    if (arena->blocks != NULL && arena->blocks->next != NULL) {
+        size_t size = 0;
+        for (ArenaBlock* block = arena->blocks; block != NULL; block = block->next) {
+            size += block->size;
+        }
+        FreeArenaBlocks(arena);
+        AddArenaBlock(arena, size);
+    }
+    if (arena->blocks != NULL) {
+        arena->blocks->used = 0;
+    }
+
+    arena->last = NULL;
+    arena->used = 0;
+}
+
+void UnloadArena(Arena* arena) {
+    RunArenaCleanups(arena);
+    FreeArenaBlocks(arena);
+    *arena = (Arena){0};
+}
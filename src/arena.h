@@ -0,0 +1,56 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator for data that dies all at once. Allocations are carved from large blocks and never freed one
+// by one, ResetArena() drops them together and keeps the memory for the next round. Resources that are not
+// plain memory, like GPU buffers, register a cleanup with ArenaDefer() and are released by the same reset.
+//
+//   Platform* platforms = ArenaAlloc(&g_screenArena, sizeof(Platform) * count);
+//   ArenaDefer(&g_screenArena, UnloadWaterCleanup, &water);
+//   DrawText(FrameFormat("water %d", level), 10, 10, 20, BLACK);
+//
+// Not thread safe, an arena belongs to one thread at a time.
+
+#define ARENA_BLOCK_SIZE    (64 * 1024)     // least size of a block, bigger allocations get a block of their own
+#define ARENA_ALIGNMENT     16
+
+typedef void (*ArenaCleanup)(void* data);
+
+typedef struct ArenaBlock ArenaBlock;
+typedef struct ArenaDeferred ArenaDeferred;
+
+typedef struct {
+    ArenaBlock* blocks;         // newest first, allocations come from the first one
+    ArenaDeferred* deferred;    // newest first
+    void* last;                 // last allocation, the only one ArenaResize() can grow in place
+    size_t used;                // bytes handed out since the last reset, padding included
+    size_t peak;
+} Arena;
+
+// Released by change_screen() between the old screen's close() and the new screen's init(). While a screen
+// loads, it belongs to the loading thread.
+extern Arena g_screenArena;
+// Released at the start of every frame, main thread only
+extern Arena g_frameArena;
+
+// Zeroed, aligned to ARENA_ALIGNMENT
+void* ArenaAlloc(Arena* arena, size_t size);
+// Grows or shrinks ptr, an allocation of oldSize bytes from the same arena. In place if it is the last one,
+// otherwise moved and the old copy stays until the reset. The new bytes are zeroed.
+void* ArenaResize(Arena* arena, void* ptr, size_t oldSize, size_t newSize);
+// Like TextFormat(), but the string lives until the reset rather than until the next few calls
+char* ArenaFormat(Arena* arena, const char* format, ...);
+// cleanup(data) runs on the next reset, cleanups run newest first and before the memory is released
+void ArenaDefer(Arena* arena, ArenaCleanup cleanup, void* data);
+
+// Runs the cleanups and drops every allocation. Memory is kept, a round that spilled over several blocks
+// leaves one block big enough for all of it.
+void ResetArena(Arena* arena);
+// ResetArena() and gives the memory back
+void UnloadArena(Arena* arena);
+
+#define FrameFormat(...) ArenaFormat(&g_frameArena, __VA_ARGS__)
+
+#endif /* ARENA_H */
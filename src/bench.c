@@ -0,0 +1,392 @@
+// Times the collision and terrain generation kernels without a window, e.g.
+//
+//   atlantis_bench --json baseline.json
+//   atlantis_bench --filter Collision --baseline baseline.json
+//
+// Every benchmark runs its warmup samples, then its timed ones. A sample calls the kernel once per input of a
+// fixed set, so the times are per call. Inputs come from a fixed seed, every run sees the same ones.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "raylib.h"
+#include "raymath.h"
+
+#include "collisions.h"
+#include "const.h"
+#include "jobs.h"
+#include "noise.h"
+#include "platform.h"
+#include "terrain_lod.h"
+
+#define BENCH_SEED          1234
+#define BENCH_INPUTS        1024    // inputs of the cheap kernels, one sample calls the kernel on each
+#define BENCH_MAX_RESULTS   32
+#define BENCH_NAME_SIZE     64
+
+typedef struct {
+    int warmup;
+    int samples;
+    const char* filter;
+    const char* jsonPath;
+    const char* baselinePath;
+} Options;
+
+typedef struct {
+    char name[BENCH_NAME_SIZE];
+    int samples;
+    int calls;          // per sample
+    double median;      // ns per call
+    double p99;
+    double min;
+    double mean;
+} BenchResult;
+
+typedef struct {
+    BenchResult items[BENCH_MAX_RESULTS];
+    int count;
+} BenchResults;
+
+// Inputs shared by the benchmarks
+typedef struct {
+    BoundingBox boxes[BENCH_INPUTS];
+    Triangle triangles[BENCH_INPUTS];
+    Plane planes[BENCH_INPUTS];
+    Vector2 lineStarts[BENCH_INPUTS];
+    Vector2 lineEnds[BENCH_INPUTS];
+    Rectangle recs[BENCH_INPUTS];
+    Vector2 points[BENCH_INPUTS];
+    Image heightmap;        // the 3D screen's map, 10x10 cells of 3 pixels
+    Mesh terrainMesh;       // of heightmap, at the 3D screen's size
+    Image largeHeightmap;   // GenImagePerlin(), 256x256
+} BenchInputs;
+
+typedef void (*BenchKernel)(const BenchInputs* inputs);
+
+static Options options;
+static BenchInputs benchInputs;
+static volatile int sink;  // kernels add their results here, so the calls are not optimised out
+
+static float RandomFloat(float min, float max) {
+    return Remap(GetRandomValue(0, 1 << 20), 0, 1 << 20, min, max);
+}
+
+static Vector3 RandomVector3(float min, float max) {
+    return (Vector3){ RandomFloat(min, max), RandomFloat(min, max), RandomFloat(min, max) };
+}
+
+// Boxes of the water grid and triangles of the terrain around them, about as many hits as misses
+static void GenerateInputs() {
+    SetRandomSeed(BENCH_SEED);
+
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        Vector3 center = RandomVector3(0.0f, 16.0f);
+        Vector3 half = { 0.5f, 0.5f, 0.5f };
+        benchInputs.boxes[i] = (BoundingBox){ Vector3Subtract(center, half), Vector3Add(center, half) };
+
+        Vector3 corner = Vector3Add(center, RandomVector3(-1.5f, 1.5f));
+        benchInputs.triangles[i] = (Triangle){
+            corner,
+            Vector3Add(corner, RandomVector3(-1.5f, 1.5f)),
+            Vector3Add(corner, RandomVector3(-1.5f, 1.5f)),
+        };
+
+        Vector3 normal = Vector3Normalize(RandomVector3(-1.0f, 1.0f));
+        benchInputs.planes[i] = (Plane){ normal, Vector3DotProduct(normal, Vector3Add(corner, RandomVector3(-1.0f, 1.0f))) };
+
+        // segments and rectangles on the 2D screen
+        benchInputs.lineStarts[i] = (Vector2){ RandomFloat(0, SCREEN_WIDTH), RandomFloat(0, SCREEN_HEIGHT) };
+        benchInputs.lineEnds[i] = Vector2Add(benchInputs.lineStarts[i], (Vector2){ RandomFloat(-200, 200), RandomFloat(-200, 200) });
+        benchInputs.recs[i] = (Rectangle){ RandomFloat(0, SCREEN_WIDTH), RandomFloat(0, SCREEN_HEIGHT), RandomFloat(10, 150), RandomFloat(10, 150) };
+
+        benchInputs.points[i] = (Vector2){ RandomFloat(0, 64), RandomFloat(0, 64) };
+    }
+
+    Image worley = GenImageWorley(10, 10, 3, 1);
+    ImageFormat(&worley, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    ImageColorInvert(&worley);
+    benchInputs.heightmap = worley;
+    benchInputs.terrainMesh = GenMeshHeightmapData(benchInputs.heightmap, (Vector3){ 16, 8, 16 });
+
+    benchInputs.largeHeightmap = GenImagePerlin(256, 256);
+}
+
+static void UnloadInputs() {
+    UnloadImage(benchInputs.heightmap);
+    UnloadImage(benchInputs.largeHeightmap);
+    MemFree(benchInputs.terrainMesh.vertices);
+    MemFree(benchInputs.terrainMesh.normals);
+    MemFree(benchInputs.terrainMesh.texcoords);
+}
+
+static void BenchBoxTriangle(const BenchInputs* inputs) {
+    int hits = 0;
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        hits += CheckCollisionBoxTriangle(inputs->boxes[i], inputs->triangles[i]);
+    }
+    sink += hits;
+}
+
+static void BenchTrianglePlane(const BenchInputs* inputs) {
+    int hits = 0;
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        Line3d line;
+        hits += CheckCollisionTrianglePlane(inputs->triangles[i], inputs->planes[i], &line);
+    }
+    sink += hits;
+}
+
+static void BenchLineRec(const BenchInputs* inputs) {
+    int hits = 0;
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        hits += CheckCollisionLineRec(inputs->lineStarts[i], inputs->lineEnds[i], inputs->recs[i]);
+    }
+    sink += hits;
+}
+
+// The 3D screen's voxelisation: a water sized box against the whole terrain mesh
+static void BenchBoxMesh(const BenchInputs* inputs) {
+    int hits = 0;
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        hits += CheckCollisionBoxMesh(inputs->boxes[i], inputs->terrainMesh, MatrixIdentity()).hit;
+    }
+    sink += hits;
+}
+
+static void BenchPerlin(const BenchInputs* inputs) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        sum += perlin(inputs->points[i].x, inputs->points[i].y);
+    }
+    sink += (int)sum;
+}
+
+static void BenchGenImagePerlin(const BenchInputs* inputs) {
+    Image image = GenImagePerlin(256, 256);
+    sink += ((unsigned char*)image.data)[0];
+    UnloadImage(image);
+}
+
+static void BenchGenImageWorley(const BenchInputs* inputs) {
+    Image image = GenImageWorley(1024, 1024, 64, 1);
+    sink += (int)((float*)image.data)[0];
+    UnloadImage(image);
+}
+
+// CPU part of GenMeshHeightmap(), the upload needs a window
+static void BenchGenMeshHeightmap(const BenchInputs* inputs) {
+    Mesh mesh = GenMeshHeightmapData(inputs->largeHeightmap, (Vector3){ 16, 8, 16 });
+    sink += mesh.vertexCount;
+    MemFree(mesh.vertices);
+    MemFree(mesh.normals);
+    MemFree(mesh.texcoords);
+}
+
+static int CompareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank, so p99 of fewer than 100 samples is the slowest one
+static double Percentile(const double* sorted, int count, double percent) {
+    int rank = (int)ceil(percent / 100.0 * count) - 1;
+    return sorted[rank < 0 ? 0 : rank >= count ? count - 1 : rank];
+}
+
+// Heavy kernels take fewer samples, so a full run stays within seconds
+static void RunBench(BenchResults* results, const char* name, BenchKernel kernel, int calls, int sampleDivisor) {
+    if (options.filter != NULL && strstr(name, options.filter) == NULL) {
+        return;
+    }
+    if (results->count == BENCH_MAX_RESULTS) {
+        printf("Too many benchmarks, %s skipped\n", name);
+        return;
+    }
+
+    int samples = options.samples / sampleDivisor > 1 ? options.samples / sampleDivisor : 1;
+    int warmup = options.warmup / sampleDivisor;
+    for (int i = 0; i < warmup; i++) {
+        kernel(&benchInputs);
+    }
+
+    double* times = MemAlloc(samples * sizeof(double));
+    double total = 0.0;
+    for (int i = 0; i < samples; i++) {
+        uint64_t start = GetClockNs();
+        kernel(&benchInputs);
+        times[i] = (double)(GetClockNs() - start) / calls;
+        total += times[i];
+    }
+    qsort(times, samples, sizeof(double), CompareDoubles);
+
+    BenchResult* result = &results->items[results->count++];
+    *result = (BenchResult){
+        .samples = samples,
+        .calls = calls,
+        .median = Percentile(times, samples, 50.0),
+        .p99 = Percentile(times, samples, 99.0),
+        .min = times[0],
+        .mean = total / samples,
+    };
+    snprintf(result->name, BENCH_NAME_SIZE, "%s", name);
+    MemFree(times);
+}
+
+// One result per line, so --baseline can read it back without a JSON parser
+static bool WriteJson(const BenchResults* results, const char* path) {
+    FILE* file = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (file == NULL) {
+        printf("Unable to open %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\"seed\":%d,\"warmup\":%d,\"samples\":%d,\"unit\":\"ns\",\"results\":[\n",
+        BENCH_SEED, options.warmup, options.samples);
+    for (int i = 0; i < results->count; i++) {
+        const BenchResult* r = &results->items[i];
+        fprintf(file, "{\"name\":\"%s\",\"median\":%.3f,\"p99\":%.3f,\"min\":%.3f,\"mean\":%.3f,\"samples\":%d,\"calls\":%d}%s\n",
+            r->name, r->median, r->p99, r->min, r->mean, r->samples, r->calls, i + 1 < results->count ? "," : "");
+    }
+    fprintf(file, "]}\n");
+
+    if (file != stdout) {
+        fclose(file);
+    }
+    return true;
+}
+
+// Median of the named benchmark in a file written by WriteJson(), negative if it is not there
+static double FindBaseline(FILE* file, const char* name) {
+    rewind(file);
+    char line[512];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char lineName[BENCH_NAME_SIZE];
+        double median;
+        if (sscanf(line, "{\"name\":\"%63[^\"]\",\"median\":%lf", lineName, &median) == 2 && strcmp(lineName, name) == 0) {
+            return median;
+        }
+    }
+
+    return -1.0;
+}
+
+static void PrintResults(FILE* out, const BenchResults* results, FILE* baseline) {
+    fprintf(out, "%-28s %12s %12s %12s %8s%s\n", "benchmark", "median ns", "p99 ns", "min ns", "samples", baseline != NULL ? "  vs baseline" : "");
+    for (int i = 0; i < results->count; i++) {
+        const BenchResult* r = &results->items[i];
+        fprintf(out, "%-28s %12.1f %12.1f %12.1f %8d", r->name, r->median, r->p99, r->min, r->samples);
+        if (baseline != NULL) {
+            double before = FindBaseline(baseline, r->name);
+            if (before > 0.0) {
+                fprintf(out, "  %+.1f%%", (r->median / before - 1.0) * 100.0);
+            } else {
+                fprintf(out, "  new");
+            }
+        }
+        fprintf(out, "\n");
+    }
+}
+
+static void PrintUsage(const char* program) {
+    printf("Usage: %s [--samples N] [--warmup N] [--filter TEXT] [--json FILE] [--baseline FILE]\n", program);
+    printf("  --samples N      timed samples per benchmark, default 200, heavy ones take fewer\n");
+    printf("  --warmup N       untimed samples run first, default 20\n");
+    printf("  --filter TEXT    only run benchmarks whose name contains TEXT\n");
+    printf("  --json FILE      write the results as JSON, '-' for stdout\n");
+    printf("  --baseline FILE  compare the medians with a file written by --json\n");
+}
+
+static bool ParseOptions(int argc, char const *argv[]) {
+    options = (Options){
+        .warmup = 20,
+        .samples = 200,
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--help") == 0) {
+            return false;
+        }
+        bool known = strcmp(arg, "--samples") == 0 || strcmp(arg, "--warmup") == 0 || strcmp(arg, "--filter") == 0
+            || strcmp(arg, "--json") == 0 || strcmp(arg, "--baseline") == 0;
+        if (!known) {
+            printf("Unknown option %s\n", arg);
+            return false;
+        }
+        if (value == NULL) {
+            printf("Missing value for %s\n", arg);
+            return false;
+        }
+
+        if (strcmp(arg, "--samples") == 0) {
+            options.samples = atoi(value);
+        } else if (strcmp(arg, "--warmup") == 0) {
+            options.warmup = atoi(value);
+        } else if (strcmp(arg, "--filter") == 0) {
+            options.filter = value;
+        } else if (strcmp(arg, "--json") == 0) {
+            options.jsonPath = value;
+        } else {
+            options.baselinePath = value;
+        }
+        i++;
+    }
+
+    if (options.samples <= 0) {
+        options.samples = 1;
+    }
+    if (options.warmup < 0) {
+        options.warmup = 0;
+    }
+
+    return true;
+}
+
+int main(int argc, char const *argv[])
+{
+    if (!ParseOptions(argc, argv)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    FILE* baseline = NULL;
+    if (options.baselinePath != NULL) {
+        baseline = fopen(options.baselinePath, "r");
+        if (baseline == NULL) {
+            printf("Unable to open %s\n", options.baselinePath);
+            return 1;
+        }
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    InitJobs(0);
+    GenerateInputs();
+
+    BenchResults results = {0};
+    RunBench(&results, "CheckCollisionBoxTriangle", BenchBoxTriangle, BENCH_INPUTS, 1);
+    RunBench(&results, "CheckCollisionTrianglePlane", BenchTrianglePlane, BENCH_INPUTS, 1);
+    RunBench(&results, "CheckCollisionLineRec", BenchLineRec, BENCH_INPUTS, 1);
+    RunBench(&results, "CheckCollisionBoxMesh", BenchBoxMesh, BENCH_INPUTS, 4);
+    RunBench(&results, "perlin", BenchPerlin, BENCH_INPUTS, 1);
+    RunBench(&results, "GenImagePerlin", BenchGenImagePerlin, 1, 10);
+    RunBench(&results, "GenImageWorley", BenchGenImageWorley, 1, 10);
+    RunBench(&results, "GenMeshHeightmap", BenchGenMeshHeightmap, 1, 10);
+
+    // the table goes to stderr when stdout takes the JSON
+    bool jsonToStdout = options.jsonPath != NULL && strcmp(options.jsonPath, "-") == 0;
+    PrintResults(jsonToStdout ? stderr : stdout, &results, baseline);
+    bool written = options.jsonPath == NULL || WriteJson(&results, options.jsonPath);
+
+    if (baseline != NULL) {
+        fclose(baseline);
+    }
+    UnloadInputs();
+    CloseJobs();
+
+    return written ? 0 : 1;
+}
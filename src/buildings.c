@@ -0,0 +1,155 @@
+#include "buildings.h"
+
+#include <string.h>
+
+#include "log.h"
+
+#define GROW(ptr, count) ptr = MemRealloc(ptr, sizeof(*(ptr)) * (count))
+
+static void ReserveColumns(BuildingStore* store) {
+    if (store->count < store->allocated) {
+        return;
+    }
+
+    store->allocated = store->allocated == 0 ? 64 : store->allocated * 2;
+    GROW(store->type, store->allocated);
+    GROW(store->powerConsumption, store->allocated);
+    GROW(store->powerProduction, store->allocated);
+    GROW(store->peopleCapacity, store->allocated);
+    GROW(store->powered, store->allocated);
+    GROW(store->body, store->allocated);
+    GROW(store->resource, store->allocated);
+    GROW(store->productionRate, store->allocated);
+    GROW(store->id, store->allocated);
+}
+
+static BuildingId NewBuildingId(BuildingStore* store) {
+    if (store->freeCount > 0) {
+        return store->freeIds[--store->freeCount];
+    }
+
+    if (store->idCount == store->idAllocated) {
+        store->idAllocated = store->idAllocated == 0 ? 64 : store->idAllocated * 2;
+        GROW(store->position, store->idAllocated);
+        GROW(store->freeIds, store->idAllocated);
+    }
+
+    return store->idCount++;
+}
+
+BuildingId AddBuilding(BuildingStore* store, Building building) {
+    ReserveColumns(store);
+
+    BuildingId id = NewBuildingId(store);
+    int i = store->count++;
+
+    store->type[i] = building.type;
+    store->powerConsumption[i] = building.powerConsumption;
+    store->powerProduction[i] = building.powerProduction;
+    store->peopleCapacity[i] = building.peopleCapacity;
+    store->powered[i] = false;
+    store->body[i] = building.body;
+    store->resource[i] = building.resource;
+    store->productionRate[i] = building.productionRate;
+    store->id[i] = id;
+    store->position[id] = i;
+
+    store->totals.powerCapacity += building.powerProduction;
+    store->totals.powerRequired += building.powerConsumption;
+    store->totals.housingCapacity += building.peopleCapacity;
+
+    return id;
+}
+
+void RemoveBuilding(BuildingStore* store, BuildingId id) {
+    int i = GetBuildingPosition(store, id);
+    if (i < 0) {
+        return;
+    }
+
+    SetBuildingPowered(store, i, false);
+    store->totals.powerCapacity -= store->powerProduction[i];
+    store->totals.powerRequired -= store->powerConsumption[i];
+    store->totals.housingCapacity -= store->peopleCapacity[i];
+
+    int last = --store->count;
+    if (i != last) {
+        store->type[i] = store->type[last];
+        store->powerConsumption[i] = store->powerConsumption[last];
+        store->powerProduction[i] = store->powerProduction[last];
+        store->peopleCapacity[i] = store->peopleCapacity[last];
+        store->powered[i] = store->powered[last];
+        store->body[i] = store->body[last];
+        store->resource[i] = store->resource[last];
+        store->productionRate[i] = store->productionRate[last];
+        store->id[i] = store->id[last];
+        store->position[store->id[i]] = i;
+    }
+
+    store->position[id] = -1;
+    store->freeIds[store->freeCount++] = id;
+}
+
+int GetBuildingPosition(const BuildingStore* store, BuildingId id) {
+    if (id < 0 || id >= store->idCount) {
+        return -1;
+    }
+
+    return store->position[id];
+}
+
+void SetBuildingPowered(BuildingStore* store, int i, bool powered) {
+    if (store->powered[i] == powered) {
+        return;
+    }
+
+    store->powered[i] = powered;
+    store->totals.production[store->resource[i]] += powered ? store->productionRate[i] : -store->productionRate[i];
+}
+
+bool CheckBuildingTotals(const BuildingStore* store) {
+    BuildingTotals expected = {0};
+    for (int i = 0; i < store->count; i++) {
+        expected.powerCapacity += store->powerProduction[i];
+        expected.powerRequired += store->powerConsumption[i];
+        expected.housingCapacity += store->peopleCapacity[i];
+        if (store->powered[i]) {
+            expected.production[store->resource[i]] += store->productionRate[i];
+        }
+    }
+
+    if (memcmp(&expected, &store->totals, sizeof(BuildingTotals)) == 0) {
+        return true;
+    }
+
+    LOGE("Building totals out of sync! power %d/%d (expected %d/%d), housing %d (expected %d)",
+        store->totals.powerRequired, store->totals.powerCapacity, expected.powerRequired, expected.powerCapacity,
+        store->totals.housingCapacity, expected.housingCapacity);
+    for (int r = 0; r < RES_LAST; r++) {
+        LOGE("    resource %d: %d (expected %d)", r, store->totals.production[r], expected.production[r]);
+    }
+
+    return false;
+}
+
+void ClearBuildingStore(BuildingStore* store) {
+    store->count = 0;
+    store->idCount = 0;
+    store->freeCount = 0;
+    store->totals = (BuildingTotals){0};
+}
+
+void UnloadBuildingStore(BuildingStore* store) {
+    MemFree(store->type);
+    MemFree(store->powerConsumption);
+    MemFree(store->powerProduction);
+    MemFree(store->peopleCapacity);
+    MemFree(store->powered);
+    MemFree(store->body);
+    MemFree(store->resource);
+    MemFree(store->productionRate);
+    MemFree(store->id);
+    MemFree(store->position);
+    MemFree(store->freeIds);
+    *store = (BuildingStore){0};
+}
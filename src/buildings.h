@@ -0,0 +1,82 @@
+#ifndef BUILDINGS_H
+#define BUILDINGS_H
+
+#include "raylib.h"
+
+typedef enum {
+    BUILDING_INVALID=0,
+    HOUSE,
+    POWER_PLANT,
+    CONCRETE_FACTORY,
+    FARM,
+    LAST
+} BuildingType;
+
+// Power is not a resource!
+typedef enum {
+    RES_INVALID=0,
+    FOOD,
+    CONCRETE,
+    RES_LAST
+} ResourceType;
+
+// Stable handle, stays valid until the building is removed. Ids of removed buildings are reused.
+typedef int BuildingId;
+
+// Everything needed to add a building to the store
+typedef struct {
+    BuildingType type;
+    int powerConsumption;
+    int powerProduction;
+    int peopleCapacity;
+    Rectangle body;
+    ResourceType resource;
+    int productionRate;
+} Building;
+
+// Kept up to date by every change to the store
+typedef struct {
+    int powerCapacity;          // sum of powerProduction
+    int powerRequired;          // sum of powerConsumption
+    int housingCapacity;        // sum of peopleCapacity
+    int production[RES_LAST];   // sum of productionRate of powered buildings, per resource
+} BuildingTotals;
+
+// Structure of arrays. Columns are indexed by the dense position [0; count) of a live building,
+// removal moves the last building into the hole, so loops never see dead slots.
+typedef struct {
+    BuildingType* type;
+    int* powerConsumption;
+    int* powerProduction;
+    int* peopleCapacity;
+    bool* powered;
+    Rectangle* body;
+    ResourceType* resource;
+    int* productionRate;
+    BuildingId* id;         // dense position -> id
+    int count;
+    int allocated;          // length of the columns above
+
+    int* position;          // id -> dense position, -1 for free ids
+    int idCount;            // ids handed out so far, length of position
+    int idAllocated;
+    BuildingId* freeIds;    // free list, reused before new ids are handed out
+    int freeCount;
+
+    BuildingTotals totals;
+} BuildingStore;
+
+BuildingId AddBuilding(BuildingStore* store, Building building);
+void RemoveBuilding(BuildingStore* store, BuildingId id);
+// Dense position of a live building, -1 if the id is not in use
+int GetBuildingPosition(const BuildingStore* store, BuildingId id);
+// Takes a dense position. Use instead of writing the powered column, it keeps totals.production in sync.
+void SetBuildingPowered(BuildingStore* store, int i, bool powered);
+
+// Recomputes the totals from scratch, prints and returns false on mismatch. Debug only, O(n).
+bool CheckBuildingTotals(const BuildingStore* store);
+
+void ClearBuildingStore(BuildingStore* store);
+void UnloadBuildingStore(BuildingStore* store);
+
+#endif /* BUILDINGS_H */
@@ -0,0 +1,505 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "raylib.h"
+#include "raymath.h"
+
+#include "arena.h"
+#include "collisions.h"
+#include "colony.h"
+#include "log.h"
+#include "profiler.h"
+
+#define GRID_CELL_SIZE              64
+#define PLACEMENT_ATTEMPTS          10
+
+typedef struct {
+    ResourceType type;
+} Resource;
+
+Balance balance[LAST];
+
+BuildingStore g_buildings;
+FloodQueue g_flood;
+PowerDispatch g_power;
+
+Ground g_ground;
+
+// Broad phase for platforms and buildings, the ground has its own index
+SpatialGrid g_grid;
+
+Platform* g_platforms;
+int g_platformsCount;
+int g_platformsCapacity;
+
+int g_totalFood;
+int g_totalConcrete;
+
+int g_powerCapacity;
+int g_powerUsage;
+int g_powerRequired;
+
+int g_totalPopulation;
+int populationCapacity;
+
+int g_gameTicks;
+
+float g_waterLevel;
+
+int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+void flashError() {
+    // TODO: show error on screen somehow
+}
+
+Line GetRotRectangleMiddleLine(RotRectangle rotRectangle) {
+    Vector2 startP = {rotRectangle.rect.x, rotRectangle.rect.y};
+    Vector2 lineStart = {rotRectangle.rect.x, rotRectangle.rect.y + rotRectangle.rect.height / 2};
+    Vector2 lineEnd = {rotRectangle.rect.x + rotRectangle.rect.width, rotRectangle.rect.y};
+    Vector2 deltaX = Vector2Subtract(lineStart, startP);
+    deltaX = Vector2Rotate(deltaX, rotRectangle.angle * DEG2RAD);
+    lineStart = Vector2Add(startP, deltaX);
+
+    Vector2 deltaY = Vector2Subtract(lineEnd, startP);
+    deltaY = Vector2Rotate(deltaY, rotRectangle.angle * DEG2RAD);
+    lineEnd = Vector2Add(Vector2Add(startP, deltaX), deltaY);
+    return (Line){lineStart, lineEnd};
+}
+
+Rectangle GetLineBounds(Line line) {
+    float minX = fmin(line.start.x, line.end.x);
+    float minY = fmin(line.start.y, line.end.y);
+    return (Rectangle){minX, minY, fmax(line.start.x, line.end.x) - minX, fmax(line.start.y, line.end.y) - minY};
+}
+
+Rectangle GetRectanglesUnion(Rectangle a, Rectangle b) {
+    float minX = fmin(a.x, b.x);
+    float minY = fmin(a.y, b.y);
+    return (Rectangle){minX, minY, fmax(a.x + a.width, b.x + b.width) - minX, fmax(a.y + a.height, b.y + b.height) - minY};
+}
+
+// The only place platforms pay for trigonometry
+void UpdatePlatformGeometry(Platform* platform) {
+    for (int i = 0; i < ARR_SIZE(platform->components); i++) {
+        platform->middleLines[i] = GetRotRectangleMiddleLine(platform->components[i]);
+    }
+
+    MyRectangle top = platform->top.rect;
+    platform->bounds = (Rectangle){top.x, top.y, top.width, top.height};
+    platform->bounds = GetRectanglesUnion(platform->bounds, GetLineBounds(platform->leftLine));
+    platform->bounds = GetRectanglesUnion(platform->bounds, GetLineBounds(platform->rightLine));
+}
+
+void MovePlatform(Platform* platform, Vector2 delta) {
+    for (int i = 0; i < ARR_SIZE(platform->components); i++) {
+        platform->components[i].rect.pos = Vector2Add(platform->components[i].rect.pos, delta);
+        platform->middleLines[i].start = Vector2Add(platform->middleLines[i].start, delta);
+        platform->middleLines[i].end = Vector2Add(platform->middleLines[i].end, delta);
+    }
+
+    platform->bounds.x += delta.x;
+    platform->bounds.y += delta.y;
+}
+
+Platform GeneratePlatform(int x, int y, int topWidth, int topHeight, int legLength, int legThickness, int legAngle) {
+    LOGD("Generate: %d %d %d %d %d %d %d", x, y, topWidth, topHeight, legLength, legThickness, legAngle);
+    // x; y = coordinates of top platform
+    Platform platform;
+    platform.top.rect = (MyRectangle){x, y, topWidth, topHeight};
+    platform.top.angle = 0;
+
+    platform.left.rect = (MyRectangle){x, y, legLength, legThickness};
+    platform.left.angle = 180 - legAngle;
+
+    platform.right.rect = (MyRectangle){x, y, legLength, legThickness};
+    platform.right.angle = legAngle;
+
+    Line topMiddleLine = GetRotRectangleMiddleLine(platform.top);
+    Line leftMiddleLine = GetRotRectangleMiddleLine(platform.left);
+    Line rightMiddleLine = GetRotRectangleMiddleLine(platform.right);
+
+    Vector2 leftDist = Vector2Subtract(topMiddleLine.start, leftMiddleLine.start);
+    platform.left.rect.pos = Vector2Add(leftDist, platform.left.rect.pos);
+
+    Vector2 rightDist = Vector2Subtract(topMiddleLine.end, rightMiddleLine.start);
+    platform.right.rect.pos = Vector2Add(rightDist, platform.right.rect.pos);
+
+    UpdatePlatformGeometry(&platform);
+    return platform;
+}
+
+void AddPlatform(Platform platform) {
+    if (g_platformsCount == g_platformsCapacity) {
+        int capacity = g_platformsCapacity == 0 ? 16 : g_platformsCapacity * 2;
+        g_platforms = ArenaResize(&g_screenArena, g_platforms, sizeof(Platform) * g_platformsCapacity, sizeof(Platform) * capacity);
+        g_platformsCapacity = capacity;
+    }
+
+    InsertSpatial(&g_grid, SPATIAL_PLATFORM, g_platformsCount, platform.bounds);
+    g_platforms[g_platformsCount] = platform;
+    g_platformsCount++;
+}
+
+void floodBuilding(BuildingId id, void* user) {
+    RemoveSpatial(&g_grid, SPATIAL_BUILDING, id);
+    RemovePowerConsumer(&g_power, id);
+    RemoveBuilding(&g_buildings, id);
+}
+
+void powerBuilding(BuildingId id, bool powered, void* user) {
+    SetBuildingPowered(&g_buildings, GetBuildingPosition(&g_buildings, id), powered);
+}
+
+void addBuilding(Building* building) {
+    BuildingId id = AddBuilding(&g_buildings, *building);
+    InsertSpatial(&g_grid, SPATIAL_BUILDING, id, building->body);
+    AddPowerConsumer(&g_power, id, building->powerConsumption, balance[building->type].powerPriority);
+    AddFloodBuilding(&g_flood, id, building->body);
+}
+
+bool canPlaceBuilding(Rectangle body) {
+    if (CheckCollisionRecGround(&g_ground, body)) {
+        return false;
+    }
+
+    QuerySpatial(&g_grid, body, SPATIAL_MASK(SPATIAL_BUILDING) | SPATIAL_MASK(SPATIAL_PLATFORM));
+    for (int h = 0; h < g_grid.hitCount; h++) {
+        SpatialHit hit = g_grid.hits[h];
+        if (hit.kind == SPATIAL_BUILDING) {
+            if (CheckCollisionRecs(body, g_buildings.body[GetBuildingPosition(&g_buildings, hit.id)])) {
+                return false;
+            }
+        } else {
+            Platform* platform = &g_platforms[hit.id];
+            MyRectangle top = platform->top.rect;
+            if (CheckCollisionRecs(body, (Rectangle){top.x, top.y, top.width, top.height})
+                || CheckCollisionLineRec(platform->leftLine.start, platform->leftLine.end, body)
+                || CheckCollisionLineRec(platform->rightLine.start, platform->rightLine.end, body)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Building resting on the highest ground point under it
+Rectangle groundBuildingBody(BuildingType type, float x) {
+    Rectangle body = {x, 0, balance[type].width, balance[type].height};
+    body.y = GetGroundTop(&g_ground, body.x, body.x + body.width) - body.height;
+    return body;
+}
+
+// Spot on the ground where the building does not overlap anything. Random, then the first free one from the
+// left, so it only fails once the ground is full.
+bool findBuildingSpot(BuildingType type, Vector2* pos) {
+    for (int attempt = 0; attempt < PLACEMENT_ATTEMPTS; attempt++) {
+        Rectangle body = groundBuildingBody(type, GetRandomValue(0, SCREEN_WIDTH));
+        if (canPlaceBuilding(body)) {
+            *pos = (Vector2){body.x, body.y};
+            return true;
+        }
+    }
+    for (int x = 0; x <= SCREEN_WIDTH; x++) {
+        Rectangle body = groundBuildingBody(type, x);
+        if (canPlaceBuilding(body)) {
+            *pos = (Vector2){body.x, body.y};
+            return true;
+        }
+    }
+
+    LOGW("Unable to place building!!!");
+    flashError();
+    return false;
+}
+
+Building initBuilding(BuildingType type, int x, int y) {
+    return (Building) {
+        .type = type,
+        .powerConsumption = balance[type].powerConsumption,
+        .body = (Rectangle){x, y, balance[type].width, balance[type].height},
+        .resource = balance[type].resource,
+        .productionRate = balance[type].productionRate
+    };
+}
+
+void addPowerPlant(int x, int y) {
+    Building powerPlant = initBuilding(POWER_PLANT, x, y);
+    powerPlant.powerProduction = BALANCE_POWER_PRODUCTION;
+
+    addBuilding(&powerPlant);
+}
+
+void addFarm(int x, int y) {
+    Building farm = initBuilding(FARM, x, y);
+
+    addBuilding(&farm);
+}
+
+void addHouse(int x, int y) {
+    Building house = initBuilding(HOUSE, x, y);
+    house.peopleCapacity = BALANCE_PEOPLE_CAPACITY;
+
+    addBuilding(&house);
+}
+
+void addConcreteFactory(int x, int y) {
+    Building concreteFactory = initBuilding(CONCRETE_FACTORY, x, y);
+
+    addBuilding(&concreteFactory);
+}
+
+void addBuildingOfType(BuildingType type, int x, int y) {
+    switch (type) {
+        case HOUSE: addHouse(x, y); break;
+        case POWER_PLANT: addPowerPlant(x, y); break;
+        case CONCRETE_FACTORY: addConcreteFactory(x, y); break;
+        case FARM: addFarm(x, y); break;
+        default: break;
+    }
+}
+
+bool PlaceBuilding(BuildingType type, float x) {
+    if (type <= BUILDING_INVALID || type >= LAST) {
+        return false;
+    }
+
+    Rectangle body = groundBuildingBody(type, x);
+    if (!canPlaceBuilding(body)) {
+        return false;
+    }
+
+    addBuildingOfType(type, body.x, body.y);
+    return true;
+}
+
+void initBuildings() {
+    Vector2 pos;
+    if (findBuildingSpot(HOUSE, &pos)) {
+        addHouse(pos.x, pos.y);
+    }
+    if (findBuildingSpot(HOUSE, &pos)) {
+        addHouse(pos.x, pos.y);
+    }
+    if (findBuildingSpot(POWER_PLANT, &pos)) {
+        addPowerPlant(pos.x, pos.y);
+    }
+    if (findBuildingSpot(FARM, &pos)) {
+        addFarm(pos.x, pos.y);
+    }
+    if (findBuildingSpot(CONCRETE_FACTORY, &pos)) {
+        addConcreteFactory(pos.x, pos.y);
+    }
+}
+
+// The ground hangs off a single draw, so the same random state always gives the same ground
+void initGround() {
+    unsigned int seed = (unsigned int)GetRandomValue(0, INT_MAX - 1);
+    GenGroundPerlin(&g_ground, BALANCE_MAP_WIDTH, BALANCE_GROUND_SEGMENTS, BALANCE_GROUND_LEVEL, BALANCE_GROUND_AMPLITUDE, seed);
+}
+
+void initBalance() {
+    balance[HOUSE] = (Balance) {
+        .price = 40,
+        .powerConsumption = 20,
+        .powerPriority = 1,
+        .resource = RES_INVALID,
+        .productionRate = 0,
+        .width = 50,
+        .height = 50
+    };
+
+    balance[FARM] = (Balance) {
+        .price = 20,
+        .powerConsumption = 10,
+        .powerPriority = 0,
+        .resource = FOOD,
+        .productionRate = 50,
+        .width = 50,
+        .height = 25
+    };
+
+    balance[CONCRETE_FACTORY] = (Balance) {
+        .price = 100,
+        .powerConsumption = 50,
+        .powerPriority = 2,
+        .resource = CONCRETE,
+        .productionRate = 10,
+        .width = 75,
+        .height = 25
+    };
+
+    balance[POWER_PLANT] = (Balance) {
+        .price = 50,
+        .powerConsumption = 0,
+        .resource = RES_INVALID,
+        .productionRate = 0,
+        .width = 25,
+        .height = 50
+    };
+}
+
+void InitColony() {
+    g_gameTicks = 0;
+    g_totalFood = 1000;
+    g_totalConcrete = 200;
+    g_totalPopulation = 100;
+    g_powerUsage = 0;
+    g_powerCapacity = 0;
+    g_powerRequired = 0;
+    g_waterLevel = 0;
+
+    ClearBuildingStore(&g_buildings);
+    InitFloodQueue(&g_flood, floodBuilding, NULL);
+    InitPowerDispatch(&g_power, powerBuilding, NULL);
+    InitSpatialGrid(&g_grid, GRID_CELL_SIZE);
+    initBalance();
+    initGround();
+    initBuildings();
+    g_platformsCount = 0;
+    g_platformsCapacity = 0;
+    g_platforms = NULL;
+
+    AddPlatform(GeneratePlatform(GetRandomValue(0, SCREEN_WIDTH), GetRandomValue(0, SCREEN_HEIGHT), BALANCE_PLATFORM_WIDTH, 10, BALANCE_PLATFORM_LEG_LENGTH, 10, BALANCE_PLATFORM_ANGLE));
+    AddPlatform(GeneratePlatform(GetRandomValue(0, SCREEN_WIDTH), GetRandomValue(0, SCREEN_HEIGHT), 100, 10, 75, 10, BALANCE_PLATFORM_ANGLE));
+    AddPlatform(GeneratePlatform(GetRandomValue(0, SCREEN_WIDTH), GetRandomValue(0, SCREEN_HEIGHT), 100, 10, 75, 10, BALANCE_PLATFORM_ANGLE));
+}
+
+void updatePower() {
+    g_powerCapacity = g_buildings.totals.powerCapacity;
+}
+
+void updateResources() {
+    g_powerRequired = g_buildings.totals.powerRequired;
+
+    // only does work when a building or the supply changed since the last economy step
+    DispatchPower(&g_power, g_powerCapacity);
+
+    g_totalFood += g_buildings.totals.production[FOOD];
+    g_totalConcrete += g_buildings.totals.production[CONCRETE];
+    g_powerUsage = g_power.used;
+}
+
+void updatePopulation() {
+    // calculate how many people we can feed
+    // maximum people capacity is kept up to date by the building store
+    int housingCapacity = g_buildings.totals.housingCapacity;
+
+    int delta = g_totalFood - g_totalPopulation;
+    if (abs(delta) > BALANCE_POPULATION_INCREMENT) {
+        delta = sign(delta) * BALANCE_POPULATION_INCREMENT;
+    }
+
+    g_totalPopulation += delta;
+    if (g_totalPopulation < 0) {
+        g_totalPopulation = 0;
+    } else if (g_totalPopulation > housingCapacity) {
+        g_totalPopulation = housingCapacity;
+    }
+
+    g_totalFood -= g_totalPopulation;
+    if (g_totalFood < 0) {
+        g_totalFood = 0;
+    }
+}
+
+void UpdateWaterLevel() {
+    g_waterLevel += BALANCE_WATER_LEVEL_SPEED;
+
+    // the water spans the whole map, only the surface height matters
+    UpdateFlood(&g_flood, BALANCE_WATER_START_POS - g_waterLevel);
+}
+
+PlatformCollision CheckCollisionPlatformGround(Platform platform) {
+    PlatformCollision result = {0};
+    Vector2 collisionPoint = {0};
+
+    Line leftMl = platform.leftLine;
+    Line rightMl = platform.rightLine;
+
+    if (CheckCollisionLineGround(&g_ground, leftMl.start, leftMl.end, &collisionPoint)) {
+        result.hitLeft = true;
+        result.pointLeft = collisionPoint;
+    }
+
+    if (CheckCollisionLineGround(&g_ground, rightMl.start, rightMl.end, &collisionPoint)) {
+        result.hitRight = true;
+        result.pointRight = collisionPoint;
+    }
+
+    return result;
+}
+
+PlatformCollision CheckCollisionPlatforms(Platform pl) {
+    PlatformCollision result = {0};
+    Vector2 collisionPoint = {0};
+
+    Line leftMl = pl.leftLine;
+    Line rightMl = pl.rightLine;
+
+    QuerySpatial(&g_grid, pl.bounds, SPATIAL_MASK(SPATIAL_PLATFORM));
+    for (int h = 0; h < g_grid.hitCount; h++) {
+        int i = g_grid.hits[h].id;
+        for (int j = 0; j < ARR_SIZE(pl.components); j++) {
+            if (result.hitLeft && result.hitRight) {
+                return result;
+            }
+
+            Line targetMl = g_platforms[i].middleLines[j];
+
+            if (!result.hitLeft && CheckCollisionLines(leftMl.start, leftMl.end, targetMl.start, targetMl.end, &collisionPoint)) {
+                result.hitLeft = true;
+                result.pointLeft = collisionPoint;
+            }
+
+            if (!result.hitRight && CheckCollisionLines(rightMl.start, rightMl.end, targetMl.start, targetMl.end, &collisionPoint)) {
+                result.hitRight = true;
+                result.pointRight = collisionPoint;
+            }
+        }
+    }
+
+    return result;
+}
+
+bool CheckPlatformSupport(Platform platform) {
+    PROFILE_BEGIN("CheckPlatformSupport");
+    PlatformCollision againstPlatforms = CheckCollisionPlatforms(platform);
+    PlatformCollision againstGround = CheckCollisionPlatformGround(platform);
+    PROFILE_END();
+
+    return (againstGround.hitLeft || againstPlatforms.hitLeft) && (againstGround.hitRight || againstPlatforms.hitRight);
+}
+
+void UpdateColony() {
+    g_gameTicks++;
+    if (g_gameTicks % BALANCE_ECONOMY_PERIOD == 0) {
+        PROFILE_BEGIN("economy");
+        updatePower();
+        updateResources();
+        updatePopulation();
+#ifndef NDEBUG
+        CheckBuildingTotals(&g_buildings);
+#endif
+        PROFILE_END();
+    }
+
+    PROFILE_BEGIN("UpdateWaterLevel");
+    UpdateWaterLevel();
+    PROFILE_END();
+}
+
+// Platforms live in the screen arena and go with it
+void CloseColony() {
+    g_platforms = NULL;
+    g_platformsCount = 0;
+    g_platformsCapacity = 0;
+    UnloadBuildingStore(&g_buildings);
+    UnloadFloodQueue(&g_flood);
+    UnloadPowerDispatch(&g_power);
+    UnloadSpatialGrid(&g_grid);
+    UnloadGround(&g_ground);
+}
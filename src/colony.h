@@ -0,0 +1,129 @@
+#ifndef COLONY_H
+#define COLONY_H
+
+#include "raylib.h"
+
+#include "buildings.h"
+#include "const.h"
+#include "flood.h"
+#include "ground.h"
+#include "power.h"
+#include "spatial_grid.h"
+
+#define BALANCE_POWER_PRODUCTION    100
+#define BALANCE_PEOPLE_CAPACITY     100
+#define BALANCE_POPULATION_INCREMENT    10
+#define BALANCE_WATER_LEVEL_SPEED   0.05f
+#define BALANCE_WATER_START_POS     SCREEN_HEIGHT
+#define BALANCE_MAP_WIDTH           SCREEN_WIDTH
+#define BALANCE_PLATFORM_ANGLE      60
+#define BALANCE_PLATFORM_WIDTH      100
+#define BALANCE_PLATFORM_LEG_LENGTH 75
+#define BALANCE_GROUND_SEGMENTS     2048
+#define BALANCE_GROUND_LEVEL        420
+#define BALANCE_GROUND_AMPLITUDE    30
+
+#define BALANCE_ECONOMY_PERIOD      30
+
+typedef struct {
+    union {
+        struct {
+            Vector2 start;
+            Vector2 end;
+        };
+        Vector2 coords[2];
+    };
+} Line;
+
+typedef struct {
+    union {
+        struct {
+            float x;
+            float y;
+        };
+        Vector2 pos;
+    };
+    float width;
+    float height;
+} MyRectangle;
+
+typedef struct {
+    MyRectangle rect;
+    float angle;
+} RotRectangle;
+
+typedef struct {
+    union {
+        struct {
+            RotRectangle left;
+            RotRectangle right;
+            RotRectangle top;
+        };
+        RotRectangle components[3];
+    };
+    // Derived geometry, computed once by UpdatePlatformGeometry() and only translated afterwards
+    union {
+        struct {
+            Line leftLine;
+            Line rightLine;
+            Line topLine;
+        };
+        Line middleLines[3];
+    };
+    Rectangle bounds;
+} Platform;
+
+typedef struct {
+    bool hitLeft;
+    bool hitRight;
+    Vector2 pointLeft;
+    Vector2 pointRight;
+} PlatformCollision;
+
+typedef struct {
+    int price;
+    int powerConsumption;
+    int powerPriority;          // lower is powered first when the supply runs short, see power.h
+    ResourceType resource;
+    float productionRate;
+    int width;
+    int height;
+} Balance;
+
+extern Balance balance[LAST];
+
+extern BuildingStore g_buildings;
+extern FloodQueue g_flood;
+extern PowerDispatch g_power;
+extern Ground g_ground;
+extern SpatialGrid g_grid;
+
+extern Platform* g_platforms;
+extern int g_platformsCount;
+
+extern int g_totalFood;
+extern int g_totalConcrete;
+extern int g_powerCapacity;
+extern int g_powerUsage;
+extern int g_powerRequired;
+extern int g_totalPopulation;
+extern int g_gameTicks;
+extern float g_waterLevel;
+
+// Simulation only, no window or input needed. game_screen drives it every frame, the headless runner as fast as it can.
+void InitColony();
+void UpdateColony();
+void CloseColony();
+
+void flashError();
+
+Platform GeneratePlatform(int x, int y, int topWidth, int topHeight, int legLength, int legThickness, int legAngle);
+void MovePlatform(Platform* platform, Vector2 delta);
+// Both legs rest on the ground or on another platform
+bool CheckPlatformSupport(Platform platform);
+void AddPlatform(Platform platform);
+
+// Drops the building on the ground at x, false if it does not fit there
+bool PlaceBuilding(BuildingType type, float x);
+
+#endif /* COLONY_H */
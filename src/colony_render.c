@@ -0,0 +1,28 @@
+#include "raylib.h"
+
+#include "colony_render.h"
+
+void QueuePlatform(RenderQueue* queue, int layer, Platform platform) {
+    MyRectangle top = platform.top.rect;
+    PushRenderRectangleLines(queue, layer, (Rectangle){ top.x, top.y, top.width, top.height }, BLACK);
+    PushRenderLine(queue, layer, platform.leftLine.start, platform.leftLine.end, BLACK);
+    PushRenderLine(queue, layer, platform.rightLine.start, platform.rightLine.end, BLACK);
+}
+
+void QueueColony(RenderQueue* queue, float waterLevel) {
+    for (int i = 0; i < g_platformsCount; i++) {
+        QueuePlatform(queue, RENDER_LAYER_WORLD, g_platforms[i]);
+    }
+
+    for (int i = 0; i < g_buildings.count; i++) {
+        Color color = g_buildings.powered[i] ? BLACK : RED;
+        PushRenderRectangleLines(queue, RENDER_LAYER_WORLD, g_buildings.body[i], color);
+    }
+
+    for (int i = 0; i + 1 < g_ground.count; i++) {
+        PushRenderLine(queue, RENDER_LAYER_WORLD, g_ground.points[i], g_ground.points[i + 1], BLACK);
+    }
+
+    PushRenderRectangle(queue, RENDER_LAYER_WATER,
+        (Rectangle){ 0, BALANCE_WATER_START_POS - waterLevel, BALANCE_MAP_WIDTH, waterLevel }, BLUE);
+}
@@ -0,0 +1,16 @@
+#ifndef COLONY_RENDER_H
+#define COLONY_RENDER_H
+
+#include "colony.h"
+#include "render_queue.h"
+
+// Layers of the 2D screen, drawn in this order
+#define RENDER_LAYER_WORLD      0   // platforms, buildings and ground
+#define RENDER_LAYER_WATER      1
+#define RENDER_LAYER_OVERLAY    2   // the platform being placed
+
+// Pushes the whole colony, shared by the game screen and the headless render stats
+void QueueColony(RenderQueue* queue, float waterLevel);
+void QueuePlatform(RenderQueue* queue, int layer, Platform platform);
+
+#endif /* COLONY_RENDER_H */
@@ -0,0 +1,78 @@
+#include "flood.h"
+
+#include <math.h>
+#include <string.h>
+
+void InitFloodQueue(FloodQueue* queue, FloodCallback onFlood, void* user) {
+    queue->count = 0;
+    queue->cursor = 0;
+    queue->waterTop = INFINITY;
+    queue->onFlood = onFlood;
+    queue->user = user;
+}
+
+void UnloadFloodQueue(FloodQueue* queue) {
+    MemFree(queue->entries);
+    *queue = (FloodQueue){0};
+}
+
+// First entry with a bottom edge above (smaller than) the given one
+static int UpperBound(const FloodQueue* queue, float bottom) {
+    int lo = queue->cursor;
+    int hi = queue->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (queue->entries[mid].bottom >= bottom) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+void AddFloodBuilding(FloodQueue* queue, BuildingId id, Rectangle body) {
+    float bottom = body.y + body.height;
+    if (bottom > queue->waterTop) {
+        queue->onFlood(id, queue->user);
+        return;
+    }
+
+    if (queue->count == queue->allocated) {
+        queue->allocated = queue->allocated == 0 ? 64 : queue->allocated * 2;
+        queue->entries = (FloodEntry*)MemRealloc(queue->entries, sizeof(FloodEntry) * queue->allocated);
+    }
+
+    int i = UpperBound(queue, bottom);
+    memmove(&queue->entries[i + 1], &queue->entries[i], sizeof(FloodEntry) * (queue->count - i));
+    queue->entries[i] = (FloodEntry){id, bottom};
+    queue->count++;
+}
+
+void RemoveFloodBuilding(FloodQueue* queue, BuildingId id, Rectangle body) {
+    // entries with the same bottom sit right before the upper bound
+    for (int i = UpperBound(queue, body.y + body.height) - 1; i >= queue->cursor; i--) {
+        if (queue->entries[i].id == id) {
+            memmove(&queue->entries[i], &queue->entries[i + 1], sizeof(FloodEntry) * (queue->count - i - 1));
+            queue->count--;
+            return;
+        }
+    }
+}
+
+void UpdateFlood(FloodQueue* queue, float waterTop) {
+    queue->waterTop = waterTop;
+    while (queue->cursor < queue->count && queue->entries[queue->cursor].bottom > waterTop) {
+        // advance first, the callback may add or remove buildings
+        BuildingId id = queue->entries[queue->cursor++].id;
+        queue->onFlood(id, queue->user);
+    }
+
+    // drop the flooded entries once they are the larger half, amortised O(1) per flooded building
+    if (queue->cursor > 0 && queue->cursor * 2 >= queue->count) {
+        memmove(queue->entries, &queue->entries[queue->cursor], sizeof(FloodEntry) * (queue->count - queue->cursor));
+        queue->count -= queue->cursor;
+        queue->cursor = 0;
+    }
+}
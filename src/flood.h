@@ -0,0 +1,39 @@
+#ifndef FLOOD_H
+#define FLOOD_H
+
+#include "raylib.h"
+
+#include "buildings.h"
+
+typedef void (*FloodCallback)(BuildingId id, void* user);
+
+typedef struct {
+    BuildingId id;
+    float bottom;           // y of the bottom edge, the water reaches larger values first
+} FloodEntry;
+
+// Water only rises, so buildings are kept sorted by their bottom edge and flooded in that order.
+// Entries before the cursor are already under water, they are dropped once they make up half the queue.
+typedef struct {
+    FloodEntry* entries;
+    int count;
+    int allocated;
+    int cursor;
+    float waterTop;         // y of the water surface at the last update
+    FloodCallback onFlood;  // fired exactly once per building
+    void* user;
+} FloodQueue;
+
+void InitFloodQueue(FloodQueue* queue, FloodCallback onFlood, void* user);
+void UnloadFloodQueue(FloodQueue* queue);
+
+// Both shift the entries above the building, O(buildings not yet flooded)
+// Floods the building right away if it is placed under water
+void AddFloodBuilding(FloodQueue* queue, BuildingId id, Rectangle body);
+// For buildings removed by something other than the water
+void RemoveFloodBuilding(FloodQueue* queue, BuildingId id, Rectangle body);
+
+// O(buildings flooded by this update)
+void UpdateFlood(FloodQueue* queue, float waterTop);
+
+#endif /* FLOOD_H */
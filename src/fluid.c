@@ -0,0 +1,1164 @@
+#include <math.h>
+#include <string.h>
+
+#include "raylib.h"
+#include "raymath.h"
+
+#include "fluid.h"
+#include "log.h"
+#include "platform.h"
+
+static int GetNodeIndex(const int* size, const int* c) {
+    return (c[0] * size[1] + c[1]) * size[2] + c[2];
+}
+
+static void GetNodeCoords(const int* size, int index, int* c) {
+    c[2] = index % size[2];
+    index /= size[2];
+    c[1] = index % size[1];
+    c[0] = index / size[1];
+}
+
+static void LoadFluidOctree(Fluid* fluid) {
+    for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+        fluid->levelSize[0][a] = (fluid->size[a] + FLUID_BRICK_SIZE - 1) / FLUID_BRICK_SIZE;
+    }
+
+    // halve until a single root node is left
+    int level = 0;
+    while (level + 1 < FLUID_OCTREE_MAX_LEVELS
+        && (fluid->levelSize[level][0] > 1 || fluid->levelSize[level][1] > 1 || fluid->levelSize[level][2] > 1)) {
+        for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+            fluid->levelSize[level + 1][a] = (fluid->levelSize[level][a] + 1) / 2;
+        }
+        level++;
+    }
+    fluid->octreeLevels = level + 1;
+
+    for (int l = 0; l < fluid->octreeLevels; l++) {
+        const int* size = fluid->levelSize[l];
+        fluid->awake[l] = MemAlloc(size[0] * size[1] * size[2]);
+    }
+
+    const int* bricks = fluid->levelSize[0];
+    fluid->brickCount = bricks[0] * bricks[1] * bricks[2];
+    fluid->brickList = MemAlloc(fluid->brickCount * sizeof(int));
+    fluid->brickStamp = MemAlloc(fluid->brickCount * sizeof(unsigned int));
+    fluid->windowMass = MemAlloc(fluid->brickCount * sizeof(double));
+    fluid->windowSteps = MemAlloc(fluid->brickCount * sizeof(int));
+    fluid->restMass = MemAlloc(fluid->brickCount * sizeof(double));
+    fluid->settled = MemAlloc(fluid->brickCount);
+    fluid->brickMass = MemAlloc(fluid->brickCount * sizeof(double));
+    fluid->brickFilled = MemAlloc(fluid->brickCount * sizeof(int));
+    fluid->brickLakes = MemAlloc(fluid->brickCount);
+    WakeFluid(fluid);
+}
+
+Fluid LoadFluid(int dims, const int* size, int gravityAxis, int gravitySign, FluidParams params) {
+    Fluid fluid = {
+        .dims = dims,
+        .gravityAxis = gravityAxis,
+        .gravitySign = gravitySign,
+        .params = params
+    };
+
+    for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+        fluid.size[a] = a < dims ? size[a] : 1;
+    }
+    fluid.stride[FLUID_MAX_DIMS - 1] = 1;
+    for (int a = FLUID_MAX_DIMS - 2; a >= 0; a--) {
+        fluid.stride[a] = fluid.stride[a + 1] * fluid.size[a + 1];
+    }
+    fluid.cellCount = fluid.stride[0] * fluid.size[0];
+
+    fluid.cells = MemAlloc(fluid.cellCount);
+    fluid.mass = MemAlloc(fluid.cellCount * sizeof(float));
+    fluid.newMass = MemAlloc(fluid.cellCount * sizeof(float));
+    fluid.lakeOf = MemAlloc(fluid.cellCount * sizeof(int));
+    fluid.lakeCells = MemAlloc(fluid.cellCount * sizeof(int));
+    memset(fluid.lakeOf, -1, fluid.cellCount * sizeof(int));
+
+    for (int x = 0; x < fluid.size[0]; x++) {
+        for (int y = 0; y < fluid.size[1]; y++) {
+            for (int z = 0; z < fluid.size[2]; z++) {
+                int c[FLUID_MAX_DIMS] = { x, y, z };
+                for (int a = 0; a < dims; a++) {
+                    if (c[a] == 0 || c[a] == fluid.size[a] - 1) {
+                        fluid.cells[GetFluidIndex(&fluid, x, y, z)] = FLUID_OCCUPIED;
+                    }
+                }
+            }
+        }
+    }
+
+    LoadFluidOctree(&fluid);
+    return fluid;
+}
+
+void UnloadFluid(Fluid* fluid) {
+    MemFree(fluid->cells);
+    MemFree(fluid->mass);
+    MemFree(fluid->newMass);
+    for (int l = 0; l < fluid->octreeLevels; l++) {
+        MemFree(fluid->awake[l]);
+    }
+    MemFree(fluid->brickList);
+    MemFree(fluid->brickStamp);
+    MemFree(fluid->windowMass);
+    MemFree(fluid->windowSteps);
+    MemFree(fluid->restMass);
+    MemFree(fluid->settled);
+    MemFree(fluid->brickMass);
+    MemFree(fluid->brickFilled);
+    MemFree(fluid->brickLakes);
+    MemFree(fluid->lakeOf);
+    MemFree(fluid->lakeCells);
+    MemFree(fluid->lakeLayerCells);
+    MemFree(fluid->lakeLayerMass);
+    MemFree(fluid->lakes);
+    MemFree(fluid->head);
+    MemFree(fluid->flux);
+    MemFree(fluid->depth);
+    MemFree(fluid->columns);
+    MemFree(fluid->brickColumns);
+    MemFree(fluid->columnStamp);
+    *fluid = (Fluid){0};
+}
+
+float GetFluidStableMass(FluidParams params, float totalMass) {
+    if (totalMass <= params.maxMass) {
+        return params.maxMass;
+    } else if (totalMass < 2 * params.maxMass + params.maxCompress) {
+        // if the top cell contains less than maxMass, the bottom cell holds a proportionally smaller excess
+        return (params.maxMass * params.maxMass + totalMass * params.maxCompress) / (params.maxMass + params.maxCompress);
+    } else {
+        return (totalMass + params.maxCompress) / 2;
+    }
+}
+
+static void WakeFluidBrick(Fluid* fluid, const int* brick) {
+    int c[FLUID_MAX_DIMS] = { brick[0], brick[1], brick[2] };
+    for (int l = 0; l < fluid->octreeLevels; l++) {
+        unsigned char* awake = &fluid->awake[l][GetNodeIndex(fluid->levelSize[l], c)];
+        if (*awake) {
+            break;      // so are its ancestors
+        }
+        *awake = 1;
+
+        for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+            c[a] >>= 1;
+        }
+    }
+}
+
+// Puts the brick to sleep, then every ancestor left without an awake child
+static void SleepFluidBrick(Fluid* fluid, const int* brick) {
+    int c[FLUID_MAX_DIMS] = { brick[0], brick[1], brick[2] };
+    fluid->awake[0][GetNodeIndex(fluid->levelSize[0], c)] = 0;
+    fluid->sleptBricks++;
+
+    for (int l = 1; l < fluid->octreeLevels; l++) {
+        for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+            c[a] >>= 1;
+        }
+
+        const int* childSize = fluid->levelSize[l - 1];
+        for (int d = 0; d < 8; d++) {
+            int child[FLUID_MAX_DIMS] = { c[0] * 2 + (d & 1), c[1] * 2 + ((d >> 1) & 1), c[2] * 2 + ((d >> 2) & 1) };
+            if (child[0] < childSize[0] && child[1] < childSize[1] && child[2] < childSize[2]
+                && fluid->awake[l - 1][GetNodeIndex(childSize, child)]) {
+                return;
+            }
+        }
+        fluid->awake[l][GetNodeIndex(fluid->levelSize[l], c)] = 0;
+    }
+}
+
+static void GetCellBrick(const Fluid* fluid, int index, int* brick) {
+    for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+        brick[a] = index / fluid->stride[a] / FLUID_BRICK_SIZE;
+        index %= fluid->stride[a];
+    }
+}
+
+// Height of the cell over the lowest interior cell
+static int GetFluidHeight(const Fluid* fluid, int index) {
+    int g = fluid->gravityAxis;
+    int c = index / fluid->stride[g] % fluid->size[g];
+    return fluid->gravitySign < 0 ? c - 1 : fluid->size[g] - 2 - c;
+}
+
+float GetFluidLakeCellMass(const Fluid* fluid, int lake, int index) {
+    const FluidLake* l = &fluid->lakes[lake];
+    return fluid->lakeLayerMass[l->firstLayer + GetFluidHeight(fluid, index) - l->bottom];
+}
+
+// Writes the lake's level back into its cells if it moved, they are simulated one by one again
+static void BreakFluidLake(Fluid* fluid, int lake) {
+    FluidLake* l = &fluid->lakes[lake];
+    if (!l->aggregated) {
+        return;
+    }
+
+    const FluidParams params = fluid->params;
+    for (int c = 0; c < l->cellCount; c++) {
+        int i = fluid->lakeCells[l->firstCell + c];
+        fluid->lakeOf[i] = -1;
+        if (!l->dirty || fluid->cells[i] == FLUID_OCCUPIED) {
+            continue;
+        }
+
+        // the totals already count what AddFluidLakeMass() moved, only the bricks catch up
+        int brick[FLUID_MAX_DIMS];
+        GetCellBrick(fluid, i, brick);
+        int b = GetNodeIndex(fluid->levelSize[0], brick);
+        float m = GetFluidLakeCellMass(fluid, lake, i);
+        fluid->brickMass[b] += m - fluid->mass[i];
+        fluid->brickFilled[b] += (m > params.minMass) - (fluid->cells[i] == FLUID_FILLED);
+        fluid->mass[i] = m;
+        fluid->cells[i] = m > params.minMass ? FLUID_FILLED : FLUID_EMPTY;
+    }
+
+    l->aggregated = false;
+    fluid->aggregatedLakes--;
+    fluid->aggregatedLakeCells -= l->cellCount;
+}
+
+static void BreakFluidLakes(Fluid* fluid) {
+    for (int l = 0; l < fluid->lakeCount; l++) {
+        BreakFluidLake(fluid, l);
+    }
+}
+
+// Edited bricks start over, their mass before the edit says nothing about where it settles
+static void ResetBrickWindow(Fluid* fluid, int brick) {
+    fluid->windowMass[brick] = 0;
+    fluid->windowSteps[brick] = 0;
+    fluid->restMass[brick] = -1;
+    fluid->settled[brick] = 0;
+}
+
+void WakeFluidCell(Fluid* fluid, int index) {
+    if (fluid->lakeOf[index] >= 0) {
+        BreakFluidLake(fluid, fluid->lakeOf[index]);
+    }
+
+    int brick[FLUID_MAX_DIMS];
+    GetCellBrick(fluid, index, brick);
+    WakeFluidBrick(fluid, brick);
+    ResetBrickWindow(fluid, GetNodeIndex(fluid->levelSize[0], brick));
+}
+
+void WakeFluid(Fluid* fluid) {
+    BreakFluidLakes(fluid);
+    for (int b = 0; b < fluid->brickCount; b++) {
+        ResetBrickWindow(fluid, b);
+    }
+    for (int l = 0; l < fluid->octreeLevels; l++) {
+        const int* size = fluid->levelSize[l];
+        memset(fluid->awake[l], 1, size[0] * size[1] * size[2]);
+    }
+}
+
+void SetFluidMass(Fluid* fluid, int index, float mass) {
+    if (fluid->cells[index] == FLUID_OCCUPIED) {
+        return;
+    }
+    if (fluid->lakeOf[index] >= 0) {
+        BreakFluidLake(fluid, fluid->lakeOf[index]);
+    }
+
+    int c[FLUID_MAX_DIMS];
+    GetCellBrick(fluid, index, c);
+    int brick = GetNodeIndex(fluid->levelSize[0], c);
+    int filled = (mass > fluid->params.minMass) - (fluid->cells[index] == FLUID_FILLED);
+    float added = mass - fluid->mass[index];
+
+    fluid->mass[index] = mass;
+    fluid->cells[index] = mass > fluid->params.minMass ? FLUID_FILLED : FLUID_EMPTY;
+    fluid->brickMass[brick] += added;
+    fluid->brickFilled[brick] += filled;
+    fluid->totalMass += added;
+    fluid->addedMass += added;
+    fluid->filledCells += filled;
+    WakeFluidBrick(fluid, c);
+}
+
+// Interior cells of a brick, first and last are inclusive
+static void GetBrickCells(const Fluid* fluid, int brick, int* first, int* last) {
+    int c[FLUID_MAX_DIMS];
+    GetNodeCoords(fluid->levelSize[0], brick, c);
+    for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+        if (a < fluid->dims) {
+            first[a] = fmaxf(c[a] * FLUID_BRICK_SIZE, 1);
+            last[a] = fminf(c[a] * FLUID_BRICK_SIZE + FLUID_BRICK_SIZE - 1, fluid->size[a] - 2);
+        } else {
+            first[a] = 0;
+            last[a] = 0;
+        }
+    }
+}
+
+static void SetBrickTotals(Fluid* fluid, int brick, double mass, int filled) {
+    fluid->totalMass += mass - fluid->brickMass[brick];
+    fluid->filledCells += filled - fluid->brickFilled[brick];
+    fluid->brickMass[brick] = mass;
+    fluid->brickFilled[brick] = filled;
+}
+
+static void CountFluidBricks(Fluid* fluid) {
+    int first[FLUID_MAX_DIMS];
+    int last[FLUID_MAX_DIMS];
+    for (int b = 0; b < fluid->brickCount; b++) {
+        GetBrickCells(fluid, b, first, last);
+        double mass = 0;
+        int filled = 0;
+        for (int x = first[0]; x <= last[0]; x++) {
+            for (int y = first[1]; y <= last[1]; y++) {
+                for (int z = first[2]; z <= last[2]; z++) {
+                    int i = GetFluidIndex(fluid, x, y, z);
+                    if (fluid->cells[i] != FLUID_OCCUPIED) {
+                        mass += fluid->mass[i];
+                        filled += fluid->cells[i] == FLUID_FILLED;
+                    }
+                }
+            }
+        }
+        SetBrickTotals(fluid, b, mass, filled);
+    }
+}
+
+// Breaks the lakes with cells in the brick before a step reads it
+static void BreakBrickLakes(Fluid* fluid, int brick) {
+    if (!fluid->brickLakes[brick]) {
+        return;
+    }
+
+    int first[FLUID_MAX_DIMS];
+    int last[FLUID_MAX_DIMS];
+    GetBrickCells(fluid, brick, first, last);
+    for (int x = first[0]; x <= last[0]; x++) {
+        for (int y = first[1]; y <= last[1]; y++) {
+            for (int z = first[2]; z <= last[2]; z++) {
+                int i = GetFluidIndex(fluid, x, y, z);
+                if (fluid->lakeOf[i] >= 0) {
+                    BreakFluidLake(fluid, fluid->lakeOf[i]);
+                }
+            }
+        }
+    }
+    fluid->brickLakes[brick] = 0;
+}
+
+void CopyFluidMass(const Fluid* fluid, float* mass) {
+    memcpy(mass, fluid->mass, fluid->cellCount * sizeof(float));
+    for (int l = 0; l < fluid->lakeCount; l++) {
+        const FluidLake* lake = &fluid->lakes[l];
+        if (!lake->aggregated || !lake->dirty) {
+            continue;
+        }
+
+        for (int c = 0; c < lake->cellCount; c++) {
+            int i = fluid->lakeCells[lake->firstCell + c];
+            mass[i] = GetFluidLakeCellMass(fluid, l, i);
+        }
+    }
+}
+
+// Clears the bricks the next step can reach from an awake one: the brick and its neighbours, for the pipe
+// solver every brick of the columns up to two away across gravity
+static void MarkQuietBricks(const Fluid* fluid, unsigned char* quiet) {
+    const int* size = fluid->levelSize[0];
+    int g = fluid->gravityAxis;
+    memset(quiet, 1, fluid->brickCount);
+
+    for (int b = 0; b < fluid->brickCount; b++) {
+        if (!fluid->awake[0][b]) {
+            continue;
+        }
+
+        int c[FLUID_MAX_DIMS];
+        GetNodeCoords(size, b, c);
+        int first[FLUID_MAX_DIMS];
+        int last[FLUID_MAX_DIMS];
+        for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+            int reach = a >= fluid->dims ? 0 : fluid->solver != FLUID_SOLVER_PIPES ? 1 : a == g ? size[a] : 2;
+            first[a] = c[a] - reach < 0 ? 0 : c[a] - reach;
+            last[a] = c[a] + reach >= size[a] ? size[a] - 1 : c[a] + reach;
+        }
+
+        for (int x = first[0]; x <= last[0]; x++) {
+            for (int y = first[1]; y <= last[1]; y++) {
+                for (int z = first[2]; z <= last[2]; z++) {
+                    quiet[GetNodeIndex(size, (int[FLUID_MAX_DIMS]){ x, y, z })] = 0;
+                }
+            }
+        }
+    }
+}
+
+static int FindFluidRoot(int* parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void LabelFluidLakes(Fluid* fluid) {
+    BreakFluidLakes(fluid);     // the bricks stay asleep, the water is level
+    fluid->lakeCount = 0;
+    fluid->lakeStep = fluid->stepCount;
+    fluid->sleptBricks = 0;
+
+    unsigned char* quiet = fluid->brickLakes;
+    MarkQuietBricks(fluid, quiet);
+
+    int first[FLUID_MAX_DIMS];
+    int last[FLUID_MAX_DIMS];
+    for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+        first[a] = a < fluid->dims ? 1 : 0;
+        last[a] = a < fluid->dims ? fluid->size[a] - 2 : 0;
+    }
+
+    // Union-find over the filled cells of quiet bricks, the border is solid so it never joins
+    int* parent = fluid->lakeOf;
+    for (int x = first[0]; x <= last[0]; x++) {
+        for (int y = first[1]; y <= last[1]; y++) {
+            for (int z = first[2]; z <= last[2]; z++) {
+                int i = GetFluidIndex(fluid, x, y, z);
+                int brick[FLUID_MAX_DIMS] = { x / FLUID_BRICK_SIZE, y / FLUID_BRICK_SIZE, z / FLUID_BRICK_SIZE };
+                bool water = fluid->cells[i] == FLUID_FILLED && quiet[GetNodeIndex(fluid->levelSize[0], brick)];
+                parent[i] = water ? i : -1;
+            }
+        }
+    }
+
+    for (int x = first[0]; x <= last[0]; x++) {
+        for (int y = first[1]; y <= last[1]; y++) {
+            for (int z = first[2]; z <= last[2]; z++) {
+                int i = GetFluidIndex(fluid, x, y, z);
+                if (parent[i] < 0) {
+                    continue;
+                }
+
+                for (int a = 0; a < fluid->dims; a++) {
+                    int j = i + fluid->stride[a];
+                    if (parent[j] < 0) {
+                        continue;
+                    }
+
+                    int ri = FindFluidRoot(parent, i);
+                    int rj = FindFluidRoot(parent, j);
+                    if (ri != rj) {
+                        parent[ri > rj ? ri : rj] = ri > rj ? rj : ri;
+                    }
+                }
+            }
+        }
+    }
+
+    // Number the roots, lakeCells maps a root to its lake until the cells are sorted into it
+    int* rootLake = fluid->lakeCells;
+    for (int i = 0; i < fluid->cellCount; i++) {
+        if (parent[i] >= 0) {
+            parent[i] = FindFluidRoot(parent, i);
+            if (parent[i] == i) {
+                rootLake[i] = fluid->lakeCount++;
+            }
+        }
+    }
+
+    fluid->lakes = MemRealloc(fluid->lakes, (fluid->lakeCount + 1) * sizeof(FluidLake));
+    for (int l = 0; l < fluid->lakeCount; l++) {
+        fluid->lakes[l] = (FluidLake){ .bottom = fluid->size[fluid->gravityAxis], .top = -1, .aggregated = true };
+    }
+
+    for (int i = 0; i < fluid->cellCount; i++) {
+        if (parent[i] >= 0) {
+            int l = rootLake[parent[i]];
+            int h = GetFluidHeight(fluid, i);
+            FluidLake* lake = &fluid->lakes[l];
+            fluid->lakeOf[i] = l;
+            lake->cellCount++;
+            lake->bottom = h < lake->bottom ? h : lake->bottom;
+            lake->top = h > lake->top ? h : lake->top;
+        }
+    }
+
+    int cellCount = 0;
+    int layerCount = 0;
+    for (int l = 0; l < fluid->lakeCount; l++) {
+        FluidLake* lake = &fluid->lakes[l];
+        lake->firstCell = cellCount;
+        lake->firstLayer = layerCount;
+        lake->layerCount = lake->top - lake->bottom + 1;
+        lake->top = lake->layerCount - 1;
+        cellCount += lake->cellCount;
+        layerCount += lake->layerCount;
+        lake->cellCount = 0;
+    }
+
+    fluid->lakeLayerCells = MemRealloc(fluid->lakeLayerCells, (layerCount + 1) * sizeof(int));
+    fluid->lakeLayerMass = MemRealloc(fluid->lakeLayerMass, (layerCount + 1) * sizeof(float));
+    memset(fluid->lakeLayerCells, 0, layerCount * sizeof(int));
+    memset(fluid->lakeLayerMass, 0, layerCount * sizeof(float));
+    memset(fluid->brickLakes, 0, fluid->brickCount);
+
+    for (int i = 0; i < fluid->cellCount; i++) {
+        int l = fluid->lakeOf[i];
+        if (l < 0) {
+            continue;
+        }
+
+        FluidLake* lake = &fluid->lakes[l];
+        int layer = lake->firstLayer + GetFluidHeight(fluid, i) - lake->bottom;
+        fluid->lakeCells[lake->firstCell + lake->cellCount++] = i;
+        fluid->lakeLayerCells[layer]++;
+        fluid->lakeLayerMass[layer] += fluid->mass[i];
+
+        int brick[FLUID_MAX_DIMS];
+        GetCellBrick(fluid, i, brick);
+        fluid->brickLakes[GetNodeIndex(fluid->levelSize[0], brick)] = 1;
+    }
+
+    // a settled layer is level, its cells all hold about the same mass
+    for (int layer = 0; layer < layerCount; layer++) {
+        fluid->lakeLayerMass[layer] /= fluid->lakeLayerCells[layer];
+    }
+    fluid->aggregatedLakes = fluid->lakeCount;
+    fluid->aggregatedLakeCells = cellCount;
+}
+
+float GetFluidLakeLevel(const Fluid* fluid, int lake) {
+    const FluidLake* l = &fluid->lakes[lake];
+    float fill = fluid->lakeLayerMass[l->firstLayer + l->top] / fluid->params.maxMass;
+    return l->bottom + l->top + fminf(fill, 1);
+}
+
+float AddFluidLakeMass(Fluid* fluid, int lake, float mass) {
+    FluidLake* l = &fluid->lakes[lake];
+    if (!l->aggregated) {
+        return 0;
+    }
+
+    const FluidParams params = fluid->params;
+    const int* layerCells = &fluid->lakeLayerCells[l->firstLayer];
+    float* layerMass = &fluid->lakeLayerMass[l->firstLayer];
+    float moved = 0;
+
+    // Fill or drain the top layer, then move on to the next one
+    while (mass != 0) {
+        int n = layerCells[l->top];
+        float before = layerMass[l->top];
+        float after;
+        float change;
+        if (mass > 0) {
+            float room = fmaxf(params.maxMass - before, 0) * n;
+            change = fminf(mass, room);
+            after = change == room ? fmaxf(before, params.maxMass) : before + change / n;
+        } else {
+            float water = before * n;
+            change = fmaxf(mass, -water);
+            after = change == -water ? 0 : before + change / n;
+        }
+
+        layerMass[l->top] = after;
+        fluid->filledCells += n * ((after > params.minMass) - (before > params.minMass));
+        moved += change;
+        mass -= change;
+
+        if (mass > 0 && l->top + 1 < l->layerCount) {
+            l->top++;
+        } else if (mass < 0 && l->top > 0) {
+            l->top--;
+        } else {
+            break;
+        }
+    }
+
+    fluid->totalMass += moved;
+    fluid->addedMass += moved;
+    l->dirty |= moved != 0;
+
+    // Higher than the lake ever was, the cells find out where the surplus spills
+    if (mass > 0) {
+        int n = layerCells[l->top];
+        int top = l->bottom + l->top;
+        BreakFluidLake(fluid, lake);
+        for (int c = 0; c < l->cellCount; c++) {
+            int i = fluid->lakeCells[l->firstCell + c];
+            if (GetFluidHeight(fluid, i) == top) {
+                SetFluidMass(fluid, i, fluid->mass[i] + mass / n);
+            }
+        }
+        moved += mass;
+    }
+
+    return moved;
+}
+
+static void AddFluidFlow(FluidStats* stats, FluidFlowDirection direction, float flow) {
+    stats->totalFlow[direction] += flow;
+    stats->maxFlow[direction] = fmaxf(stats->maxFlow[direction], flow);
+}
+
+static void CollectAwakeBricks(Fluid* fluid, int level, const int* c) {
+    int index = GetNodeIndex(fluid->levelSize[level], c);
+    if (!fluid->awake[level][index]) {
+        return;
+    }
+
+    if (level == 0) {
+        fluid->brickList[fluid->awakeBrickCount++] = index;
+        fluid->brickStamp[index] = fluid->stepCount;
+        return;
+    }
+
+    const int* childSize = fluid->levelSize[level - 1];
+    for (int d = 0; d < 8; d++) {
+        int child[FLUID_MAX_DIMS] = { c[0] * 2 + (d & 1), c[1] * 2 + ((d >> 1) & 1), c[2] * 2 + ((d >> 2) & 1) };
+        if (child[0] < childSize[0] && child[1] < childSize[1] && child[2] < childSize[2]) {
+            CollectAwakeBricks(fluid, level - 1, child);
+        }
+    }
+}
+
+// Lists the awake bricks, then the sleeping ones next to them, which awake cells can push water into
+static void ListFluidBricks(Fluid* fluid) {
+    fluid->stepCount++;
+    fluid->awakeBrickCount = 0;
+    CollectAwakeBricks(fluid, fluid->octreeLevels - 1, (int[FLUID_MAX_DIMS]){ 0, 0, 0 });
+    fluid->listedBrickCount = fluid->awakeBrickCount;
+
+    const int* size = fluid->levelSize[0];
+    for (int b = 0; b < fluid->awakeBrickCount; b++) {
+        int c[FLUID_MAX_DIMS];
+        GetNodeCoords(size, fluid->brickList[b], c);
+        for (int a = 0; a < fluid->dims; a++) {
+            for (int side = -1; side <= 1; side += 2) {
+                int n[FLUID_MAX_DIMS] = { c[0], c[1], c[2] };
+                n[a] += side;
+                if (n[a] < 0 || n[a] >= size[a]) {
+                    continue;
+                }
+
+                int index = GetNodeIndex(size, n);
+                if (fluid->brickStamp[index] != fluid->stepCount) {
+                    fluid->brickStamp[index] = fluid->stepCount;
+                    fluid->brickList[fluid->listedBrickCount++] = index;
+                }
+            }
+        }
+    }
+
+    for (int b = 0; b < fluid->listedBrickCount; b++) {
+        BreakBrickLakes(fluid, fluid->brickList[b]);
+    }
+}
+
+// Wakes a brick that moved water, puts one that did not to sleep. With the cellular solver, also one whose
+// mean mass held still. Call after SetBrickTotals().
+static void UpdateBrickSleep(Fluid* fluid, int brick, bool moved) {
+    if (fluid->solver == FLUID_SOLVER_CELLULAR) {
+        fluid->windowMass[brick] += fluid->brickMass[brick];
+        fluid->windowSteps[brick]++;
+    }
+    if (fluid->windowSteps[brick] == FLUID_SLEEP_STEPS) {
+        double mean = fluid->windowMass[brick] / FLUID_SLEEP_STEPS;
+        double tolerance = FLUID_SLEEP_DRIFT * fluid->params.maxMass;
+        for (int a = 0; a < fluid->dims; a++) {
+            tolerance *= FLUID_BRICK_SIZE;
+        }
+        fluid->settled[brick] = fluid->restMass[brick] >= 0 && fabs(mean - fluid->restMass[brick]) < tolerance;
+        fluid->restMass[brick] = mean;
+        fluid->windowMass[brick] = 0;
+        fluid->windowSteps[brick] = 0;
+    }
+    moved &= !fluid->settled[brick];
+
+    int c[FLUID_MAX_DIMS];
+    GetNodeCoords(fluid->levelSize[0], brick, c);
+    if (moved) {
+        WakeFluidBrick(fluid, c);
+    } else if (fluid->awake[0][brick]) {
+        SleepFluidBrick(fluid, c);
+    }
+}
+
+// True if the neighbour of the cell at c along axis is in its brick or in another listed one
+static bool IsNeighbourListed(const Fluid* fluid, const int* c, int axis, int side) {
+    int n[FLUID_MAX_DIMS];
+    for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+        n[a] = c[a] / FLUID_BRICK_SIZE;
+    }
+    int neighbour = (c[axis] + side) / FLUID_BRICK_SIZE;
+    if (neighbour == n[axis]) {
+        return true;
+    }
+
+    n[axis] = neighbour;
+    return fluid->brickStamp[GetNodeIndex(fluid->levelSize[0], n)] == fluid->stepCount;
+}
+
+static float DampFlow(FluidParams params, float flow) {
+    return flow > params.minFlow ? flow * 0.5f : flow;
+}
+
+static void StepFluidCellular(Fluid* fluid) {
+    const FluidParams params = fluid->params;
+    FluidStats* stats = &fluid->stats;
+    const unsigned char* cells = fluid->cells;
+    float* mass = fluid->mass;
+    float* newMass = fluid->newMass;
+    int first[FLUID_MAX_DIMS];
+    int last[FLUID_MAX_DIMS];
+
+    ListFluidBricks(fluid);
+
+    // newMass mirrors mass over every listed brick, the only cells a step can reach
+    for (int b = 0; b < fluid->listedBrickCount; b++) {
+        GetBrickCells(fluid, fluid->brickList[b], first, last);
+        for (int x = first[0]; x <= last[0]; x++) {
+            for (int y = first[1]; y <= last[1]; y++) {
+                int row = GetFluidIndex(fluid, x, y, first[2]);
+                memcpy(&newMass[row], &mass[row], (last[2] - first[2] + 1) * sizeof(float));
+            }
+        }
+    }
+
+    int g = fluid->gravityAxis;
+    int below = fluid->gravitySign * fluid->stride[g];
+
+    // Left, right, then front, back on the axes across gravity
+    int sides[2 * (FLUID_MAX_DIMS - 1)];
+    int sideAxes[2 * (FLUID_MAX_DIMS - 1)];
+    int sideCount = 0;
+    for (int a = 0; a < fluid->dims; a++) {
+        if (a != g) {
+            for (int side = -1; side <= 1; side += 2) {
+                sides[sideCount] = side * fluid->stride[a];
+                sideAxes[sideCount++] = a;
+            }
+        }
+    }
+
+    // Every listed brick is stepped, but water only moves between listed bricks. A sleeping brick is at rest,
+    // so the flows across its border cancel out and skipping both directions keeps it that way.
+    for (int b = 0; b < fluid->listedBrickCount; b++) {
+        GetBrickCells(fluid, fluid->brickList[b], first, last);
+        for (int x = first[0]; x <= last[0]; x++) {
+            for (int y = first[1]; y <= last[1]; y++) {
+                for (int z = first[2]; z <= last[2]; z++) {
+                    int i = GetFluidIndex(fluid, x, y, z);
+                    if (cells[i] == FLUID_OCCUPIED) {
+                        continue;
+                    }
+                    int c[FLUID_MAX_DIMS] = { x, y, z };
+
+                    float remaining = mass[i];
+                    if (remaining <= 0) {
+                        continue;
+                    }
+
+                    // Below
+                    int n = i + below;
+                    if (cells[n] != FLUID_OCCUPIED && IsNeighbourListed(fluid, c, g, fluid->gravitySign)) {
+                        float flow = DampFlow(params, GetFluidStableMass(params, remaining + mass[n]) - mass[n]);
+                        stats->clampedFlows += flow > params.maxSpeed && remaining > params.maxSpeed;
+                        flow = Clamp(flow, 0, fminf(params.maxSpeed, remaining));
+                        AddFluidFlow(stats, FLUID_FLOW_DOWN, flow);
+
+                        newMass[i] -= flow;
+                        newMass[n] += flow;
+                        remaining -= flow;
+                    }
+
+                    // Sideways, equalize the amount of water in this cell and its neighbour
+                    for (int s = 0; s < sideCount && remaining > 0; s++) {
+                        n = i + sides[s];
+                        if (cells[n] != FLUID_OCCUPIED && IsNeighbourListed(fluid, c, sideAxes[s], sides[s] > 0 ? 1 : -1)) {
+                            float flow = DampFlow(params, (mass[i] - mass[n]) / 4);
+                            flow = Clamp(flow, 0, remaining);
+                            AddFluidFlow(stats, FLUID_FLOW_SIDE, flow);
+
+                            newMass[i] -= flow;
+                            newMass[n] += flow;
+                            remaining -= flow;
+                        }
+                    }
+
+                    if (remaining <= 0) {
+                        continue;
+                    }
+
+                    // Up. Only compressed water flows upwards.
+                    n = i - below;
+                    if (cells[n] != FLUID_OCCUPIED && IsNeighbourListed(fluid, c, g, -fluid->gravitySign)) {
+                        float flow = DampFlow(params, remaining - GetFluidStableMass(params, remaining + mass[n]));
+                        stats->clampedFlows += flow > params.maxSpeed && remaining > params.maxSpeed;
+                        flow = Clamp(flow, 0, fminf(params.maxSpeed, remaining));
+                        AddFluidFlow(stats, FLUID_FLOW_UP, flow);
+
+                        if (flow > 0) {
+                            LOGT("fluid [%d;%d;%d](%.2f) up: %.2f", x, y, z, newMass[i], flow);
+                        }
+                        newMass[i] -= flow;
+                        newMass[n] += flow;
+                        remaining -= flow;
+                    }
+                }
+            }
+        }
+    }
+
+    // Commit the listed bricks, the ones that moved water stay awake
+    float epsilon = FLUID_SLEEP_EPSILON * params.maxMass;
+    for (int b = 0; b < fluid->listedBrickCount; b++) {
+        GetBrickCells(fluid, fluid->brickList[b], first, last);
+        bool moved = false;
+        double brickMass = 0;
+        int filled = 0;
+        for (int x = first[0]; x <= last[0]; x++) {
+            for (int y = first[1]; y <= last[1]; y++) {
+                for (int z = first[2]; z <= last[2]; z++) {
+                    int i = GetFluidIndex(fluid, x, y, z);
+                    if (cells[i] == FLUID_OCCUPIED) {
+                        continue;
+                    }
+
+                    moved |= fabsf(newMass[i] - mass[i]) > epsilon;
+                    mass[i] = newMass[i];
+                    fluid->cells[i] = mass[i] > params.minMass ? FLUID_FILLED : FLUID_EMPTY;
+                    brickMass += mass[i];
+                    filled += fluid->cells[i] == FLUID_FILLED;
+                    stats->activeCells++;
+                }
+            }
+        }
+        SetBrickTotals(fluid, fluid->brickList[b], brickMass, filled);
+        UpdateBrickSleep(fluid, fluid->brickList[b], moved);
+    }
+}
+
+// Brick columns of the listed bricks and their neighbours across gravity, pipes to any other column are closed
+static void ListFluidColumns(Fluid* fluid) {
+    const int* size = fluid->levelSize[0];
+    int g = fluid->gravityAxis;
+
+    fluid->brickColumnCount = 0;
+    for (int b = 0; b < fluid->listedBrickCount; b++) {
+        int c[FLUID_MAX_DIMS];
+        GetNodeCoords(size, fluid->brickList[b], c);
+        c[g] = 0;
+
+        for (int d = 0; d < 9; d++) {
+            int n[FLUID_MAX_DIMS] = { c[0], c[1], c[2] };
+            int offset[2] = { d % 3 - 1, d / 3 - 1 };
+            for (int a = 0, k = 0; a < FLUID_MAX_DIMS; a++) {
+                if (a != g) {
+                    n[a] += a < fluid->dims ? offset[k] : 0;
+                    k++;
+                }
+            }
+            // 2D has a single axis across gravity, the stamp drops the repeats
+            if (n[0] < 0 || n[0] >= size[0] || n[1] < 0 || n[1] >= size[1] || n[2] < 0 || n[2] >= size[2]) {
+                continue;
+            }
+
+            int index = GetNodeIndex(size, n);
+            if (fluid->columnStamp[index] != fluid->stepCount) {
+                fluid->columnStamp[index] = fluid->stepCount;
+                fluid->brickColumns[fluid->brickColumnCount++] = index;
+            }
+        }
+    }
+
+    fluid->columnCount = 0;
+    for (int b = 0; b < fluid->brickColumnCount; b++) {
+        // the whole column is read, not only the listed bricks
+        int c[FLUID_MAX_DIMS];
+        GetNodeCoords(size, fluid->brickColumns[b], c);
+        for (c[g] = 0; c[g] < size[g]; c[g]++) {
+            BreakBrickLakes(fluid, GetNodeIndex(size, c));
+        }
+
+        int first[FLUID_MAX_DIMS];
+        int last[FLUID_MAX_DIMS];
+        GetBrickCells(fluid, fluid->brickColumns[b], first, last);
+        first[g] = 0;
+        last[g] = 0;
+        for (int x = first[0]; x <= last[0]; x++) {
+            for (int y = first[1]; y <= last[1]; y++) {
+                for (int z = first[2]; z <= last[2]; z++) {
+                    fluid->columns[fluid->columnCount++] = GetFluidIndex(fluid, x, y, z);
+                }
+            }
+        }
+    }
+}
+
+// True if the column of the cell at c, moved by one cell along axis, was listed
+static bool IsColumnListed(const Fluid* fluid, const int* c, int axis, int side) {
+    int n[FLUID_MAX_DIMS] = { c[0], c[1], c[2] };
+    n[axis] += side;
+    for (int a = 0; a < FLUID_MAX_DIMS; a++) {
+        n[a] /= FLUID_BRICK_SIZE;
+    }
+    n[fluid->gravityAxis] = 0;
+    return fluid->columnStamp[GetNodeIndex(fluid->levelSize[0], n)] == fluid->stepCount;
+}
+
+// Moves the water of every run of open cells in the listed columns to its bottom, maxMass per cell.
+// A sealed run holds more than that, the excess is spread evenly as pressure.
+static void SettleFluidColumns(Fluid* fluid, float* mass) {
+    const FluidParams params = fluid->params;
+    int g = fluid->gravityAxis;
+    int up = -fluid->gravitySign * fluid->stride[g];
+    int height = fluid->size[g] - 2;
+    int bottom = (fluid->gravitySign < 0 ? 1 : fluid->size[g] - 2) * fluid->stride[g];
+
+    for (int c = 0; c < fluid->columnCount; c++) {
+        int start = fluid->columns[c] + bottom;
+        for (int h = 0; h < height;) {
+            if (fluid->cells[start + h * up] == FLUID_OCCUPIED) {
+                h++;
+                continue;
+            }
+
+            int first = h;
+            float total = 0;
+            for (; h < height && fluid->cells[start + h * up] != FLUID_OCCUPIED; h++) {
+                total += mass[start + h * up];
+            }
+
+            int count = h - first;
+            float depth = fmaxf(total / params.maxMass, 1);
+            float excess = fmaxf(total - count * params.maxMass, 0) / count;
+            for (int k = first; k < h; k++) {
+                int i = start + k * up;
+                float m = fminf(total, params.maxMass) + excess;
+                total -= fminf(total, params.maxMass);
+                AddFluidFlow(&fluid->stats, FLUID_FLOW_DOWN, fmaxf(m - mass[i], 0));
+                mass[i] = m;
+                fluid->depth[i] = depth;
+                fluid->cells[i] = m > params.minMass ? FLUID_FILLED : FLUID_EMPTY;
+            }
+        }
+    }
+}
+
+void SetFluidSolver(Fluid* fluid, FluidSolver solver) {
+    fluid->solver = solver;
+    WakeFluid(fluid);
+    if (solver != FLUID_SOLVER_PIPES) {
+        return;
+    }
+
+    if (fluid->head == NULL) {
+        fluid->head = MemAlloc(fluid->cellCount * sizeof(float));
+        fluid->flux = MemAlloc(fluid->cellCount * (fluid->dims - 1) * sizeof(float));
+        fluid->depth = MemAlloc(fluid->cellCount * sizeof(float));
+        fluid->columns = MemAlloc(fluid->cellCount / fluid->size[fluid->gravityAxis] * sizeof(int));
+        fluid->brickColumns = MemAlloc(fluid->brickCount * sizeof(int));
+        fluid->columnStamp = MemAlloc(fluid->brickCount * sizeof(unsigned int));
+    }
+    memset(fluid->flux, 0, fluid->cellCount * (fluid->dims - 1) * sizeof(float));
+
+    // everything is awake, so this lists and settles every column
+    ListFluidBricks(fluid);
+    ListFluidColumns(fluid);
+    SettleFluidColumns(fluid, fluid->mass);
+    CountFluidBricks(fluid);
+}
+
+static void StepFluidPipes(Fluid* fluid) {
+    const FluidParams params = fluid->params;
+    FluidStats* stats = &fluid->stats;
+    const unsigned char* cells = fluid->cells;
+    float* mass = fluid->mass;
+    float* oldMass = fluid->newMass;
+    float* head = fluid->head;
+    float* flux = fluid->flux;
+    int axisCount = fluid->dims - 1;
+
+    ListFluidBricks(fluid);
+    ListFluidColumns(fluid);
+
+    int g = fluid->gravityAxis;
+    int up = -fluid->gravitySign * fluid->stride[g];
+    int height = fluid->size[g] - 2;
+    int bottom = (fluid->gravitySign < 0 ? 1 : fluid->size[g] - 2) * fluid->stride[g];
+
+    int axes[FLUID_MAX_DIMS - 1];
+    int strides[FLUID_MAX_DIMS - 1];
+    for (int a = 0, k = 0; a < fluid->dims; a++) {
+        if (a != g) {
+            axes[k] = a;
+            strides[k++] = fluid->stride[a];
+        }
+    }
+
+    // Head, top down: the cell's floor plus the water in and resting on it
+    for (int c = 0; c < fluid->columnCount; c++) {
+        int start = fluid->columns[c] + bottom;
+        float above = 0;
+        for (int h = height - 1; h >= 0; h--) {
+            int i = start + h * up;
+            if (cells[i] == FLUID_OCCUPIED) {
+                above = 0;
+                continue;
+            }
+
+            float m = mass[i] / params.maxMass;
+            head[i] = h + m + above;
+            above += m;
+        }
+    }
+
+    // Pipes accelerate with the head difference, positive flux goes to the next cell on the axis.
+    // Every submerged level of two columns has a pipe, the gain is split between them so the columns
+    // exchange water at the same rate whatever their depth.
+    for (int c = 0; c < fluid->columnCount; c++) {
+        int coords[FLUID_MAX_DIMS];
+        GetNodeCoords(fluid->size, fluid->columns[c], coords);
+        bool open[FLUID_MAX_DIMS - 1];
+        for (int k = 0; k < axisCount; k++) {
+            open[k] = IsColumnListed(fluid, coords, axes[k], 1);
+        }
+
+        int start = fluid->columns[c] + bottom;
+        for (int h = 0; h < height; h++) {
+            int i = start + h * up;
+            for (int k = 0; k < axisCount; k++) {
+                int j = i + strides[k];
+                float* f = &flux[i * axisCount + k];
+                if (!open[k] || cells[i] == FLUID_OCCUPIED || cells[j] == FLUID_OCCUPIED
+                    || (mass[i] <= params.minMass && mass[j] <= params.minMass)) {
+                    *f = 0;
+                    continue;
+                }
+
+                float gain = FLUID_PIPE_GAIN / fmaxf(fluid->depth[i], fluid->depth[j]);
+                *f = *f * FLUID_PIPE_DAMPING + gain * params.maxMass * (head[i] - head[j]);
+                stats->clampedFlows += fabsf(*f) > params.maxSpeed;
+                *f = Clamp(*f, -params.maxSpeed, params.maxSpeed);
+            }
+        }
+    }
+
+    // A cell can not give more than it holds, head is reused for the scale of its outflow
+    for (int c = 0; c < fluid->columnCount; c++) {
+        int coords[FLUID_MAX_DIMS];
+        GetNodeCoords(fluid->size, fluid->columns[c], coords);
+        bool open[FLUID_MAX_DIMS - 1];
+        for (int k = 0; k < axisCount; k++) {
+            open[k] = IsColumnListed(fluid, coords, axes[k], -1);
+        }
+
+        int start = fluid->columns[c] + bottom;
+        for (int h = 0; h < height; h++) {
+            int i = start + h * up;
+            if (cells[i] == FLUID_OCCUPIED) {
+                continue;
+            }
+
+            float outflow = 0;
+            for (int k = 0; k < axisCount; k++) {
+                outflow += fmaxf(flux[i * axisCount + k], 0);
+                if (open[k]) {
+                    outflow += fmaxf(-flux[(i - strides[k]) * axisCount + k], 0);
+                }
+            }
+            head[i] = outflow > mass[i] ? mass[i] / outflow : 1.0f;
+            oldMass[i] = mass[i];
+        }
+    }
+
+    for (int c = 0; c < fluid->columnCount; c++) {
+        int start = fluid->columns[c] + bottom;
+        for (int h = 0; h < height; h++) {
+            int i = start + h * up;
+            for (int k = 0; k < axisCount; k++) {
+                float* f = &flux[i * axisCount + k];
+                if (*f == 0) {
+                    continue;
+                }
+
+                int j = i + strides[k];
+                *f *= *f > 0 ? head[i] : head[j];
+                AddFluidFlow(stats, FLUID_FLOW_SIDE, fabsf(*f));
+                mass[i] -= *f;
+                mass[j] += *f;
+            }
+        }
+    }
+
+    SettleFluidColumns(fluid, mass);
+
+    // Bricks of the listed columns that moved water or still carry a flux stay awake
+    stats->steppedBricks = 0;
+    float epsilon = FLUID_SLEEP_EPSILON * params.maxMass;
+    for (int b = 0; b < fluid->brickColumnCount; b++) {
+        int c[FLUID_MAX_DIMS];
+        GetNodeCoords(fluid->levelSize[0], fluid->brickColumns[b], c);
+        for (c[g] = 0; c[g] < fluid->levelSize[0][g]; c[g]++) {
+            int brick = GetNodeIndex(fluid->levelSize[0], c);
+            int first[FLUID_MAX_DIMS];
+            int last[FLUID_MAX_DIMS];
+            GetBrickCells(fluid, brick, first, last);
+
+            bool moved = false;
+            double brickMass = 0;
+            int filled = 0;
+            for (int x = first[0]; x <= last[0]; x++) {
+                for (int y = first[1]; y <= last[1]; y++) {
+                    for (int z = first[2]; z <= last[2]; z++) {
+                        int i = GetFluidIndex(fluid, x, y, z);
+                        if (cells[i] == FLUID_OCCUPIED) {
+                            continue;
+                        }
+
+                        moved |= fabsf(mass[i] - oldMass[i]) > epsilon;
+                        for (int k = 0; k < axisCount; k++) {
+                            moved |= fabsf(flux[i * axisCount + k]) > epsilon;
+                        }
+                        brickMass += mass[i];
+                        filled += cells[i] == FLUID_FILLED;
+                        stats->activeCells++;
+                    }
+                }
+            }
+            SetBrickTotals(fluid, brick, brickMass, filled);
+            UpdateBrickSleep(fluid, brick, moved);
+            stats->steppedBricks++;
+        }
+    }
+}
+
+void StepFluid(Fluid* fluid) {
+    uint64_t start = GetClockNs();
+    FluidStats* stats = &fluid->stats;
+    *stats = (FluidStats){ .step = stats->step + 1 };
+
+    if (fluid->solver == FLUID_SOLVER_PIPES) {
+        StepFluidPipes(fluid);
+    } else {
+        StepFluidCellular(fluid);
+        stats->steppedBricks = fluid->listedBrickCount;
+    }
+
+    // the last bricks to settle are labelled right away, callers stop stepping once the fluid is asleep
+    if (fluid->sleptBricks > 0
+        && (fluid->stepCount - fluid->lakeStep >= FLUID_LAKE_RELABEL_STEPS || IsFluidAsleep(fluid))) {
+        LabelFluidLakes(fluid);
+    }
+
+    stats->totalMass = fluid->totalMass;
+    stats->massDrift = fluid->totalMass - fluid->addedMass;
+    stats->filledCells = fluid->filledCells;
+    stats->awakeBricks = fluid->awakeBrickCount;
+    stats->lakes = fluid->aggregatedLakes;
+    stats->lakeCells = fluid->aggregatedLakeCells;
+    stats->stepTime = (GetClockNs() - start) * 1e-9;
+}
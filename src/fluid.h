@@ -0,0 +1,217 @@
+#ifndef FLUID_H
+#define FLUID_H
+
+#include "raylib.h"
+
+// Compressible cellular water, shared by the 2D experiment and the 3D screen. A full cell holds maxMass,
+// cells under other water hold slightly more, the excess pushes water back up so connected basins level out.
+
+#define FLUID_MAX_DIMS 3
+
+// Sleep octree
+#define FLUID_BRICK_SIZE        4       // cells along every used axis of an octree leaf, power of two
+#define FLUID_OCTREE_MAX_LEVELS 16
+#define FLUID_SLEEP_EPSILON     2e-5f   // a brick whose cells all moved less mass than this, in maxMass, falls asleep
+// With the cellular solver, a brick whose mean mass over FLUID_SLEEP_STEPS steps moved less than
+// FLUID_SLEEP_DRIFT per cell, in maxMass, from the last such window falls asleep too. That solver never stops
+// sloshing flows just under minFlow back and forth, so its bricks only settle this way and keep the last
+// slosh frozen.
+#define FLUID_SLEEP_STEPS       64
+#define FLUID_SLEEP_DRIFT       4e-3f
+
+// Lakes
+#define FLUID_LAKE_RELABEL_STEPS    64      // least steps between two labellings of the settled water
+
+// Virtual pipe solver
+#define FLUID_PIPE_GAIN     0.25f   // flux gained per step and unit of head difference between two columns, in maxMass
+#define FLUID_PIPE_DAMPING  0.95f   // flux kept from the last step, the rest is lost to friction
+
+typedef enum {
+    // Every cell trades a fraction of its mass with its neighbours. Cheap, but a basin levels out by diffusion,
+    // so wide ones take hundreds of steps.
+    FLUID_SOLVER_CELLULAR=0,
+    // Columns settle at once and a pipe between every pair of side neighbours carries a flux that accelerates
+    // with their difference in hydrostatic head. Surfaces move like waves and level out in a few dozen steps.
+    FLUID_SOLVER_PIPES,
+} FluidSolver;
+
+typedef enum {
+    FLUID_EMPTY=0,
+    FLUID_FILLED,
+    FLUID_OCCUPIED      // solid, never holds water
+} FluidCell;
+
+typedef enum {
+    FLUID_FLOW_DOWN=0,  // the pipe solver counts the columns settling here
+    FLUID_FLOW_SIDE,
+    FLUID_FLOW_UP,
+    FLUID_FLOW_DIRECTIONS
+} FluidFlowDirection;
+
+// Counters of the last StepFluid(), cheap enough to keep on
+typedef struct {
+    unsigned int step;
+    float totalMass;
+    float massDrift;                                // mass the solver created or lost since LoadFluid(), edits through SetFluidMass() excluded
+    int filledCells;                                // in the whole grid
+    int activeCells;                                // non solid cells stepped
+    int awakeBricks;                                // when the step began
+    int steppedBricks;
+    float totalFlow[FLUID_FLOW_DIRECTIONS];         // mass moved
+    float maxFlow[FLUID_FLOW_DIRECTIONS];           // largest single flow
+    int clampedFlows;                               // flows cut to maxSpeed
+    int lakes;                                      // held as aggregates after the step
+    int lakeCells;
+    double stepTime;                                // seconds
+} FluidStats;
+
+typedef struct {
+    float maxMass;      // normal, un-pressurized mass of a full cell
+    float maxCompress;  // excess mass a cell can store compared to the cell above it
+    float minMass;      // cells with less are dry
+    float minFlow;      // flows above it are halved, damps oscillation
+    float maxSpeed;     // mass moved vertically between two cells per step
+} FluidParams;
+
+// A settled body of connected water held as one volume. Every cell of a layer across gravity holds the same
+// mass and only the top layer is partly filled, so the level moves without touching the cells. They are
+// written back when something disturbs the lake: a step reaching it, an edit or a wake.
+typedef struct {
+    int firstCell;          // in lakeCells
+    int cellCount;
+    int firstLayer;         // in lakeLayerCells and lakeLayerMass
+    int layerCount;
+    int bottom;             // height of the lowest layer, 0 is the lowest interior cell
+    int top;                // highest layer holding water, from the bottom one
+    bool aggregated;        // false once broken back into cells
+    bool dirty;             // the level moved since the cells were written
+} FluidLake;
+
+// Row major, the last used axis is contiguous. Unused axes have size 1, so index(x, y) == index(x, y, 0).
+// The outermost layer of every used axis is a solid border, steps never read past it.
+typedef struct {
+    int dims;                       // 2 or 3
+    int size[FLUID_MAX_DIMS];       // cells per axis, border included
+    int stride[FLUID_MAX_DIMS];
+    int cellCount;
+    int gravityAxis;
+    int gravitySign;                // +1 when the cell below has the larger index, as in screen coordinates
+    FluidParams params;
+    FluidSolver solver;
+
+    unsigned char* cells;           // FluidCell
+    float* mass;
+    float* newMass;                 // scratch for StepFluid(), only valid over the bricks it steps
+
+    // Octree over bricks of FLUID_BRICK_SIZE cells, a node is awake while any brick under it is. Full and
+    // empty regions at rest fall asleep and collapse into the coarsest sleeping node, StepFluid() only walks
+    // down awake nodes and steps their bricks plus the sleeping bricks next to them. A body of water at rest
+    // costs nothing, a moving one costs its surface and fronts. Edits wake the brick they touch.
+    int octreeLevels;
+    int levelSize[FLUID_OCTREE_MAX_LEVELS][FLUID_MAX_DIMS];    // nodes per axis, level 0 are the bricks
+    unsigned char* awake[FLUID_OCTREE_MAX_LEVELS];
+    int brickCount;
+    int* brickList;                 // bricks stepped by the last step, the awake ones first
+    int awakeBrickCount;
+    int listedBrickCount;
+    unsigned int* brickStamp;       // step a brick was last listed
+    double* windowMass;             // sum of the brick mass over the steps of its current sleep window
+    int* windowSteps;
+    double* restMass;               // mean of its last full window, negative before the first one
+    unsigned char* settled;         // its last two windows agreed, it sleeps however its cells move
+    unsigned int stepCount;
+
+    // Running totals, kept up to date by the steps and SetFluidMass(). Mass written directly is seen as drift.
+    double* brickMass;
+    int* brickFilled;
+    double totalMass;
+    double addedMass;               // by SetFluidMass()
+    int filledCells;
+    FluidStats stats;               // of the last step
+
+    // Lakes, relabelled by StepFluid() every FLUID_LAKE_RELABEL_STEPS at most once bricks fell asleep, and
+    // as soon as the whole fluid is
+    int* lakeOf;                    // lake of every cell, -1 for none or a broken one
+    int* lakeCells;                 // cells of every lake, one run per lake
+    int* lakeLayerCells;            // cells per layer, one run per lake
+    float* lakeLayerMass;           // mass of every cell of the layer
+    FluidLake* lakes;
+    int lakeCount;
+    int aggregatedLakes;
+    int aggregatedLakeCells;
+    unsigned char* brickLakes;      // bricks holding cells of an aggregated lake
+    unsigned int lakeStep;          // stepCount at the last labelling
+    int sleptBricks;                // since then
+
+    // FLUID_SOLVER_PIPES only
+    float* head;                    // water surface height over the cell, in cells, 0 at the lowest interior cell
+    float* flux;                    // dims - 1 per cell, mass flowing to the next cell on each axis across gravity
+    float* depth;                   // water in the cell's run of open cells, in maxMass, at least 1
+    int* columns;                   // columns stepped by the last step, index at gravity coordinate 0
+    int columnCount;
+    int* brickColumns;              // the same as brick indexes at gravity coordinate 0
+    int brickColumnCount;
+    unsigned int* columnStamp;      // by brick column, step it was last listed
+} Fluid;
+
+// size[dims], the border included. Everything starts empty apart from the border.
+Fluid LoadFluid(int dims, const int* size, int gravityAxis, int gravitySign, FluidParams params);
+void UnloadFluid(Fluid* fluid);
+
+static inline int GetFluidIndex(const Fluid* fluid, int x, int y, int z) {
+    return x * fluid->stride[0] + y * fluid->stride[1] + z * fluid->stride[2];
+}
+
+// Mass the lower of two stacked cells holds at rest when they share totalMass
+float GetFluidStableMass(FluidParams params, float totalMass);
+
+// Sets the mass of a non solid cell and its state, breaks the lake holding it
+void SetFluidMass(Fluid* fluid, int index, float mass);
+
+float GetFluidLakeCellMass(const Fluid* fluid, int lake, int index);
+
+// mass[] is stale under a lake whose level moved, read through these
+static inline float GetFluidMass(const Fluid* fluid, int index) {
+    int lake = fluid->lakeOf[index];
+    return lake >= 0 && fluid->lakes[lake].dirty ? GetFluidLakeCellMass(fluid, lake, index) : fluid->mass[index];
+}
+void CopyFluidMass(const Fluid* fluid, float* mass);
+
+// Labels the connected water of bricks no awake brick can reach with union-find, every body becomes a lake.
+// StepFluid() calls it on its own.
+void LabelFluidLakes(Fluid* fluid);
+
+// Lake holding the cell, -1 if none
+static inline int GetFluidLake(const Fluid* fluid, int index) {
+    return fluid->lakeOf[index];
+}
+
+// Water surface over the lowest interior cell, in cells
+float GetFluidLakeLevel(const Fluid* fluid, int lake);
+
+// Cells of the top layer
+static inline int GetFluidLakeArea(const Fluid* fluid, int lake) {
+    const FluidLake* l = &fluid->lakes[lake];
+    return fluid->lakeLayerCells[l->firstLayer + l->top];
+}
+
+// Raises or lowers the level, O(layers crossed). Water above the highest layer the lake held breaks it
+// back into cells, the surplus goes to its top layer and spills from there. Returns the mass moved, less
+// than asked when draining the lake dry.
+float AddFluidLakeMass(Fluid* fluid, int lake, float mass);
+
+// Wakes the brick holding the cell and breaks its lake. Call after writing cells directly, before writing mass.
+void WakeFluidCell(Fluid* fluid, int index);
+void WakeFluid(Fluid* fluid);
+
+// True once every brick is asleep, stepping changes nothing until an edit wakes one
+static inline bool IsFluidAsleep(const Fluid* fluid) {
+    return !fluid->awake[fluid->octreeLevels - 1][0];
+}
+
+// Switching keeps the water where it is, the pipe fluxes start at rest
+void SetFluidSolver(Fluid* fluid, FluidSolver solver);
+
+void StepFluid(Fluid* fluid);
+
+#endif /* FLUID_H */
@@ -3,28 +3,33 @@
 #include "game_screen.h"
 #include "game_screen_3d.h"
 #include "game_over_screen.h"
+#include "input.h"
+#include "log.h"
+#include "profiler.h"
 
 #include "raylib.h"
 
 void game_over_init() {
-    printf("%s called!\n", __FUNCTION__);
+    LOGI("%s called!", __FUNCTION__);
 }
 
 screen_t game_over_update() {
-    if (IsKeyPressed(KEY_ENTER)) {
-        return game_screen_3d;
-    } 
+    PROFILE_BEGIN("game_over_update");
+    screen_t next = IsInputKeyPressed(KEY_ENTER) ? game_screen_3d : game_over_screen;
+    PROFILE_END();
 
-    return game_over_screen;
+    return next;
 }
 
-void game_over_draw() {
+void game_over_draw(float alpha) {
+    PROFILE_BEGIN("game_over_draw");
     ClearBackground(RAYWHITE);
     DrawText(" ", 10, 10, 32, BLACK);
+    PROFILE_END();
 }
 
 void game_over_close() {
-    printf("%s called!\n", __FUNCTION__);
+    LOGI("%s called!", __FUNCTION__);
 }
 
 screen_t game_over_screen = {
@@ -1,66 +1,75 @@
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "raylib.h"
 #include "raymath.h"
 
+#include "arena.h"
 #include "collisions.h"
 #include "const.h"
+#include "fluid.h"
 #include "game_screen_3d.h"
+#include "input.h"
+#include "jobs.h"
+#include "loading_screen.h"
+#include "log.h"
+#include "noise.h"
+#include "profiler.h"
+#include "render_queue.h"
+#include "terrain_cache.h"
+#include "terrain_lod.h"
 
 #define MAP_W           16
 #define MAP_L           16
 #define MAP_H           8
 #define MAP_CELLS_X     10
 #define MAP_CELLS_Y     10
+#define MAP_CELL_TILE   3
 
 #define BOX_SIZE        1.0f
 
+#define WATER_STEP_TICKS        5
+
+#define TERRAIN_LOD_LEAF_SIZE   8
+#define TERRAIN_LOD_PIXEL_ERROR 2.0f
+
 #define WATER_W         (int)(MAP_W/BOX_SIZE)
 #define WATER_L         (int)(MAP_L/BOX_SIZE)
 #define WATER_H         (int)(MAP_H/BOX_SIZE + 5)
+#define WATER_CELLS     ((WATER_W+2)*(WATER_H+2)*(WATER_L+2))
 
+unsigned int mapSeed;  // drawn on the main thread for every visit, also keys the terrain cache
 Camera camera;
+Image heightmap;       // from load to init, unloaded once uploaded
+Camera prevCamera;     // camera before the last tick, drawing interpolates from it
 Texture2D texture;
 Mesh mesh;
 Model model;
 Vector3 mapPosition;
 Ray mouseRay;
 RayCollision modelCollision;
+TerrainLod terrain;
+TerrainLodSelection terrainSelection;
 
 TriangleCollisionInfo info;
 Vector3 boxPos;
 
 int waterUpdateCounter;
 
-typedef enum {
-    EMPTY=0,
-    FILLED,
-    OCCUPIED
-} CellState;
-
-CellState water[WATER_W+2][WATER_H+2][WATER_L+2];
-float mass[WATER_W+2][WATER_H+2][WATER_L+2];
-float new_mass[WATER_W+2][WATER_H+2][WATER_L+2];
-
-//Water properties
-float MaxMass = 1.0f; //The normal, un-pressurized mass of a full water cell
-float MaxCompress = 0.02f; //How much excess water a cell can store, compared to the cell above it
-float MinMass = 0.0001f;  //Ignore cells that are almost dry
-float MinFlow = 0.1f;
+// Gravity along -y, the screen's params are stiffer than the 2D experiment's
+#define WATER_PARAMS (FluidParams){ .maxMass = 1.0f, .maxCompress = 0.02f, .minMass = 0.0001f, .minFlow = 0.1f, .maxSpeed = 4.0f }
+#define WATER_INDEX(x, y, z) GetFluidIndex(&water, x, y, z)
+#define WATER_SOLVER FLUID_SOLVER_PIPES     // M switches between the solvers
+
+Fluid water;
+float prev_mass[WATER_CELLS];  // mass before the last water step
+bool waterEdited;               // a lake level moved since then
+
+RenderQueue waterQueue;     // every visible water cube in one batch
+bool showWaterStats;        // F3
+
 float MinDraw = 0.05f;
-float MaxSpeed = 4.0f;   //max units of water moved out of one block to another, per timestep
-
-float get_stable_state_b(float total_mass) {
-    if (total_mass <= 1) {
-        return 1.0f;
-    } else if (total_mass < 2 * MaxMass + MaxCompress) {
-        // if the top cell contains less than MaxMass units of water, the bottom cell will contain a proportionally smaller excess amount
-        return (MaxMass * MaxMass + total_mass * MaxCompress) / (MaxMass + MaxCompress);
-    } else {
-        return (total_mass + MaxCompress) / 2;
-    }
-}
 
 void TranslateModel(Model* model, Vector3 pos) {
     // Matrix, 4x4 components, column major, OpenGL style, right handed
@@ -82,258 +91,298 @@ TriangleCollisionInfo CheckWaterBox(int i, int j, int k) {
     Vector3 boxHalf = {BOX_SIZE/2, BOX_SIZE/2, BOX_SIZE/2};
     Vector3 boxPos = Vector3Add((Vector3){i*BOX_SIZE, j*BOX_SIZE, k*BOX_SIZE}, mapPosition);
     BoundingBox testBox = {Vector3Subtract(boxPos, boxHalf), Vector3Add(boxPos, boxHalf)};
-    return CheckCollisionBoxMesh(testBox, mesh, model.transform);
+    return CheckCollisionBoxMesh(testBox, mesh, MatrixTranslate(mapPosition.x, mapPosition.y, mapPosition.z));
 }
 
-void InitWater() {
-    for (int i = 0; i < WATER_W+2; i++) {
+// Every generator input of the 3D map, hashed into the terrain cache key
+typedef struct {
+    int version;
+    unsigned int seed;
+    int cellsX;
+    int cellsY;
+    int tileSize;
+    Vector3 size;
+    Vector3 position;
+    int waterW;
+    int waterH;
+    int waterL;
+    float boxSize;
+} TerrainParams;
+
+// Slabs of constant x write disjoint cells
+void VoxelizeSlabs(int first, int last, void* data) {
+    for (int i = first; i < last; i++) {
         for (int j = 0; j < WATER_H+2; j++) {
             for (int k = 0; k < WATER_L+2; k++) {
                 TriangleCollisionInfo info = CheckWaterBox(i, j, k);
                 if (info.hit) {
-                    water[i][j][k] = OCCUPIED;
+                    water.cells[WATER_INDEX(i, j, k)] = FLUID_OCCUPIED;
                 }
             }
         }
     }
+}
 
-    for (int i = 0; i < WATER_W+2; i++) {
-        for (int j = 0; j < WATER_H+2; j++) {
-            for (int k = 0; k < WATER_L+2; k++) {
-                if (i == 0 || k == 0 || i == WATER_W + 1 || k == WATER_L + 1) {
-                    water[i][j][k] = OCCUPIED;
-                }
-            }
-        }
-    }
+// The expensive part of InitWater(), its result is what the terrain cache stores
+void VoxelizeTerrain() {
+    ParallelFor(0, WATER_W+2, 1, VoxelizeSlabs, NULL);
+}
 
-    // memset(water, 0, sizeof(water));
+// Expects the terrain to be voxelised already
+void InitWater() {
     for (int i = 1; i < WATER_W; i++) {
         for (int j = 1; j < WATER_L; j++) {
-            water[i][0][j] = OCCUPIED;
-            water[i][WATER_H-1][j] = FILLED;
-            water[i][WATER_H-2][j] = FILLED;
-            mass[i][WATER_H-1][j] = 1.0;
-            mass[i][WATER_H-2][j] = 1.0;
-            new_mass[i][WATER_H-1][j] = 1.0;
-            new_mass[i][WATER_H-2][j] = 1.0;
-            // water[i][1][j] = OCCUPIED;
+            SetFluidMass(&water, WATER_INDEX(i, WATER_H-1, j), 1.0f);
+            SetFluidMass(&water, WATER_INDEX(i, WATER_H-2, j), 1.0f);
         }
     }
-    
-    water[WATER_W-1][WATER_H-1][WATER_L-1] = FILLED;
-    mass[WATER_W-1][WATER_H-1][WATER_L-1] = 1.0;
-    new_mass[WATER_W-1][WATER_H-1][WATER_L-1] = 1.0;
-}
-
-void game_init_3d() {
-    printf("%s called\n", __FUNCTION__);
 
-    waterUpdateCounter = 0;
-
-    // Define our custom camera to look into our 3d world
-    // camera = (Camera){ { 18.0f, 18.0f, 18.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, 0 };
-    camera = (Camera){ { 18.0f, 18.0f, 18.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, 0 };
+    SetFluidMass(&water, WATER_INDEX(WATER_W-1, WATER_H-1, WATER_L-1), 1.0f);
+    SetFluidSolver(&water, WATER_SOLVER);
+    CopyFluidMass(&water, prev_mass);
+}
 
+// Generates the heightmap, mesh and voxels from scratch and stores them in the terrain cache
+void GenerateTerrain(uint64_t cacheKey) {
+    SetLoadingProgress(0.0f, "Generating terrain");
     // Image image = LoadImage("../assets/heightmap.png");             // Load heightmap image (RAM)
-    Image image = GenImageCellular(MAP_CELLS_X, MAP_CELLS_Y, 3);
-    ImageColorInvert(&image);
-    texture = LoadTextureFromImage(image);                // Convert image to texture (VRAM)
+    heightmap = GenImageWorley(MAP_CELLS_X, MAP_CELLS_Y, MAP_CELL_TILE, mapSeed);
+    ImageFormat(&heightmap, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    ImageColorInvert(&heightmap);           // peaks at the feature points
 
-    mesh = GenMeshHeightmap(image, (Vector3){ MAP_W, MAP_H, MAP_L });    // Generate heightmap mesh (RAM and VRAM)
+    SetLoadingProgress(0.2f, "Building terrain mesh");
+    mesh = GenMeshHeightmapData(heightmap, (Vector3){ MAP_W, MAP_H, MAP_L });    // Generate heightmap mesh (RAM only)
     // mesh = GenMeshCube(10, 10, 10);
 
-    model = LoadModelFromMesh(mesh);                          // Load model from generated mesh
+    SetLoadingProgress(0.4f, "Voxelising terrain");
+    PROFILE_BEGIN("VoxelizeTerrain");
+    VoxelizeTerrain();
+    PROFILE_END();
 
-    model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = texture;         // Set map diffuse texture
-    mapPosition = (Vector3){ -MAP_W/2.0f, 0.0f, -MAP_L/2.0f };                   // Define model position
-    TranslateModel(&model, mapPosition);
-
-    InitWater();
-
-    boxPos = (Vector3) {0.0f, 0.0f, 0.0f};
-
-    printf("%d %d\n", model.meshes[0].vertexCount, model.meshes[0].triangleCount);
-
-    for (size_t i = 0; i < mesh.vertexCount * 3; i += 3) {
-        printf("%f ", mesh.vertices[i]);
-        printf("%f\n", mesh.vertices[i+2]);
+    TerrainCacheData cache = { heightmap, mesh, MemAlloc(WATER_CELLS * sizeof(bool)), WATER_CELLS };
+    for (int i = 0; i < cache.cellCount; i++) {
+        cache.occupied[i] = water.cells[i] == FLUID_OCCUPIED;
     }
-    printf("\n");
+    SaveTerrainCache(cacheKey, &cache);
+    MemFree(cache.occupied);
+}
 
-    UnloadImage(image);                     // Unload heightmap image from RAM, already uploaded to VRAM
+// Screen arena cleanups, each registered once what it unloads exists and run newest first when the screen changes
+void UnloadWater(void* data) {
+    UnloadRenderQueue(&waterQueue);
+    UnloadFluid(&water);
+}
 
-    SetCameraMode(camera, CAMERA_ORBITAL);  // Set an orbital camera mode
-    // SetCameraMode(camera, CAMERA_FREE);  // Set an orbital camera mode
+// CPU copies from game_load_3d(), only left over if game_init_3d() never ran
+void UnloadTerrainData(void* data) {
+    UnloadImage(heightmap);
+    heightmap = (Image){0};
+    if (mesh.vboId == NULL) {
+        MemFree(mesh.vertices);
+        MemFree(mesh.normals);
+        MemFree(mesh.texcoords);
+    }
+    mesh = (Mesh){0};
 }
 
-void UpdateWater() {
-    float flow = 0;
-    float remaining_mass;
+void UnloadTerrain(void* data) {
+    UnloadTerrainLodSelection(&terrainSelection);
+    UnloadTerrainLod(&terrain);
+}
 
-    for (int x = 0; x < WATER_W; x++) {
-        for (int y = 0; y < WATER_H; y++) {
-            for (int z = 0; z < WATER_L; z++) {
-                if (water[x][y][z] == OCCUPIED) {
-                    continue;
-                }
+// The model owns the uploaded mesh, not the texture
+void UnloadTerrainModel(void* data) {
+    UnloadModel(model);
+    UnloadTexture(texture);
+    model = (Model){0};
+    mesh = (Mesh){0};
+}
 
-                flow = 0;
-                remaining_mass = mass[x][y][z];
-                if (remaining_mass <= 0) {
-                    continue;
-                }
+// Main thread: a new map every visit, the load only reads the seed
+void game_prepare_3d() {
+    mapSeed = (unsigned int)GetRandomValue(0, INT_MAX - 1);
+}
 
-                // Below
-                if (water[x][y-1][z] != OCCUPIED) {
-                    flow = get_stable_state_b(remaining_mass + mass[x][y-1][z]) - mass[x][y-1][z];
-                    if (flow > MinFlow) {
-                        flow *= 0.5;
-                    }
-                    flow = Clamp(flow, 0, fmin(MaxSpeed, remaining_mass));
+// Worker thread: everything that only needs the CPU
+void game_load_3d() {
+    mapPosition = (Vector3){ -MAP_W/2.0f, 0.0f, -MAP_L/2.0f };                   // Define model position
 
-                    new_mass[x][y][z] -= flow;
-                    new_mass[x][y-1][z] += flow;
+    water = LoadFluid(3, (int[]){ WATER_W+2, WATER_H+2, WATER_L+2 }, 1, -1, WATER_PARAMS);
+    ArenaDefer(&g_screenArena, UnloadWater, NULL);
+
+    TerrainParams params = {
+        .version = 2,           // GenImageWorley()
+        .seed = mapSeed,
+        .cellsX = MAP_CELLS_X,
+        .cellsY = MAP_CELLS_Y,
+        .tileSize = MAP_CELL_TILE,
+        .size = { MAP_W, MAP_H, MAP_L },
+        .position = mapPosition,
+        .waterW = WATER_W,
+        .waterH = WATER_H,
+        .waterL = WATER_L,
+        .boxSize = BOX_SIZE
+    };
+    uint64_t cacheKey = HashTerrainParams(&params, sizeof(params));
+
+    SetLoadingProgress(0.0f, "Loading cached terrain");
+    TerrainCacheData cache;
+    PROFILE_BEGIN("LoadTerrainCache");
+    bool cached = LoadTerrainCache(cacheKey, WATER_CELLS, &cache);
+    PROFILE_END();
+    if (cached) {
+        heightmap = cache.heightmap;
+        mesh = cache.mesh;
+        for (int i = 0; i < cache.cellCount; i++) {
+            if (cache.occupied[i]) {
+                water.cells[i] = FLUID_OCCUPIED;
+            }
+        }
+        MemFree(cache.occupied);
+    } else {
+        GenerateTerrain(cacheKey);
+    }
+    ArenaDefer(&g_screenArena, UnloadTerrainData, NULL);
 
-                    remaining_mass -= flow;
-                }
+    // the full resolution mesh is still used for picking, the LOD terrain is only drawn
+    SetLoadingProgress(0.6f, "Building terrain LOD");
+    terrain = LoadTerrainLod(heightmap, (Vector3){ MAP_W, MAP_H, MAP_L }, mapPosition, TERRAIN_LOD_LEAF_SIZE);
+    ArenaDefer(&g_screenArena, UnloadTerrain, NULL);
 
-                if (remaining_mass <= 0) {
-                    continue;
-                }
+    SetLoadingProgress(0.8f, "Filling water");
+    PROFILE_BEGIN("InitWater");
+    InitWater();
+    PROFILE_END();
 
-                // Left
-                if (water[x-1][y][z] != OCCUPIED) {
-                    // Equalize the amount of water in this block and it's neighbour
-                    flow = (mass[x][y][z] - mass[x-1][y][z]) / 4;
-                    if (flow > MinFlow) {
-                        flow *= 0.5;
-                    }
-                    flow = Clamp(flow, 0, remaining_mass);
+    SetLoadingProgress(1.0f, "Uploading");
+}
 
-                    // printf("[%d;%d;%d]: %.2f -> [LEFT]: %.2f: %f\n", x, y, z, new_mass[x][y][z], new_mass[x-1][y][z], flow);
-                    new_mass[x][y][z] -= flow;
-                    new_mass[x-1][y][z] += flow;
-                    remaining_mass -= flow;
-                }
+// Main thread: GPU uploads of what game_load_3d() prepared
+void game_init_3d() {
+    LOGI("%s called", __FUNCTION__);
 
-                if (remaining_mass <= 0) {
-                    continue;
-                }
-                
-                // Right
-                if (water[x+1][y][z] != OCCUPIED) {
-                    flow = (mass[x][y][z] - mass[x+1][y][z]) / 4;
-                    if (flow > MinFlow) {
-                        flow *= 0.5;
-                    }
-                    flow = Clamp(flow, 0, remaining_mass);
+    waterUpdateCounter = 0;
 
-                    new_mass[x][y][z] -= flow;
-                    new_mass[x+1][y][z] += flow;
-                    remaining_mass -= flow;
-                }
+    // Define our custom camera to look into our 3d world
+    // camera = (Camera){ { 18.0f, 18.0f, 18.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, 0 };
+    camera = (Camera){ { 18.0f, 18.0f, 18.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, 0 };
 
-                if (remaining_mass <= 0) {
-                    continue;
-                }
-                
-                // Front
-                if (water[x][y][z-1] != OCCUPIED) {
-                    flow = (mass[x][y][z] - mass[x][y][z-1]) / 4;
-                    if (flow > MinFlow) {
-                        flow *= 0.5;
-                    }
-                    flow = Clamp(flow, 0, remaining_mass);
+    texture = LoadTextureFromImage(heightmap);                // Convert image to texture (VRAM)
+    UploadMesh(&mesh, false);
 
-                    new_mass[x][y][z] -= flow;
-                    new_mass[x][y][z-1] += flow;
-                    remaining_mass -= flow;
-                }
+    model = LoadModelFromMesh(mesh);                          // Load model from generated mesh
 
-                
-                if (remaining_mass <= 0) {
-                    continue;
-                }
-                
-                // Back
-                if (water[x][y][z+1] != OCCUPIED) {
-                    flow = (mass[x][y][z] - mass[x][y][z+1]) / 4;
-                    if (flow > MinFlow) {
-                        flow *= 0.5;
-                    }
-                    flow = Clamp(flow, 0, remaining_mass);
+    model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = texture;         // Set map diffuse texture
+    TranslateModel(&model, mapPosition);
+    ArenaDefer(&g_screenArena, UnloadTerrainModel, NULL);
 
-                    new_mass[x][y][z] -= flow;
-                    new_mass[x][y][z+1] += flow;
-                    remaining_mass -= flow;
-                }
+    boxPos = (Vector3) {0.0f, 0.0f, 0.0f};
 
-                if (remaining_mass <= 0) {
-                    continue;
-                }
+    LOGD("%d %d", model.meshes[0].vertexCount, model.meshes[0].triangleCount);
 
-                // Up. Only compressed water flows upwards.
+    UnloadImage(heightmap);                 // Unload heightmap image from RAM, already uploaded to VRAM
+    heightmap = (Image){0};
 
-                if (mass[x][y+1][z] != OCCUPIED) {
-                    flow = remaining_mass - get_stable_state_b(remaining_mass + mass[x][y+1][z]);
-                    if (flow > MinFlow) {
-                        flow *= 0.5;
-                    }
+    SetCameraMode(camera, CAMERA_ORBITAL);  // Set an orbital camera mode
+    // SetCameraMode(camera, CAMERA_FREE);  // Set an orbital camera mode
+    prevCamera = camera;
+}
 
-                    flow = Clamp(flow, 0, fmin(MaxSpeed, remaining_mass));
+// Lake of the first water cell above the terrain point under the mouse, -1 if none
+int GetPointedLake() {
+    if (!modelCollision.hit) {
+        return -1;
+    }
 
-                    if (flow > 0) {
-                        printf("[%d;%d;%d](%.2f) -> [%d;%d;%d](%.2f): %.2f\n", x, y, z, new_mass[x][y][z], x, y+1, z, new_mass[x][y+1][z], flow);
-                    }
-                    new_mass[x][y][z] -= flow;
-                    new_mass[x][y+1][z] += flow;
-                    remaining_mass -= flow;
-                }
-            }
+    Vector3 cell = Vector3Scale(Vector3Subtract(modelCollision.point, mapPosition), 1.0f / BOX_SIZE);
+    int i = Clamp(roundf(cell.x), 1, WATER_W);
+    int k = Clamp(roundf(cell.z), 1, WATER_L);
+    for (int j = Clamp(roundf(cell.y), 1, WATER_H); j <= WATER_H; j++) {
+        int lake = GetFluidLake(&water, WATER_INDEX(i, j, k));
+        if (lake >= 0) {
+            return lake;
         }
     }
+    return -1;
+}
 
-    memcpy(&mass, &new_mass, sizeof(mass));
+screen_t game_update_3d() {
+    PROFILE_BEGIN("game_update_3d");
+    prevCamera = camera;
+    UpdateInputCamera(&camera);         // Update camera
 
-    for (int x = 1; x < WATER_W; x++) {
-        for (int y = 1; y < WATER_H; y++) {
-            for (int z = 1; z < WATER_L; z++) {
-                if (water[x][y][z] == OCCUPIED) {
-                    continue;
-                }
+    if (IsInputKeyPressed(KEY_M)) {
+        SetFluidSolver(&water, water.solver == FLUID_SOLVER_PIPES ? FLUID_SOLVER_CELLULAR : FLUID_SOLVER_PIPES);
+    }
 
-                if (mass[x][y][z] > MinMass) {
-                    water[x][y][z] = FILLED;
-                } else {
-                    water[x][y][z] = EMPTY;
-                }
-            }
-        }
+    // R raises the lake under the mouse by half a cell, F lowers it
+    int lake = GetPointedLake();
+    if (lake >= 0 && (IsInputKeyPressed(KEY_R) || IsInputKeyPressed(KEY_F))) {
+        float mass = GetFluidLakeArea(&water, lake) * water.params.maxMass * 0.5f;
+        AddFluidLakeMass(&water, lake, IsInputKeyPressed(KEY_R) ? mass : -mass);
+        waterEdited = true;
     }
-}
 
-screen_t game_update_3d() {
-    UpdateCamera(&camera);              // Update camera
+    // only changes what is drawn, so it is not recorded
+    if (IsKeyPressed(KEY_F3)) {
+        showWaterStats = !showWaterStats;
+    }
 
     waterUpdateCounter++;
-    if (waterUpdateCounter % 5 == 0) {
-        UpdateWater();    
+    // once asleep a step would change nothing, prev_mass is already within FLUID_SLEEP_EPSILON of the mass
+    if (waterUpdateCounter % WATER_STEP_TICKS == 0 && (!IsFluidAsleep(&water) || waterEdited)) {
+        waterEdited = false;
+        CopyFluidMass(&water, prev_mass);
+        PROFILE_BEGIN("UpdateWater");
+        StepFluid(&water);
+        PROFILE_END();
     }
 
-    mouseRay = GetMouseRay(GetMousePosition(), camera);
+    PROFILE_BEGIN("GetRayCollisionMesh");
+    mouseRay = GetMouseRay(GetInputMousePosition(), camera);
     modelCollision = GetRayCollisionMesh(mouseRay, mesh, model.transform);
+    PROFILE_END();
 
+    PROFILE_BEGIN("SelectTerrainLod");
+    SelectTerrainLod(&terrain, (TerrainLodView){ camera.position, camera.fovy, SCREEN_HEIGHT, TERRAIN_LOD_PIXEL_ERROR }, &terrainSelection);
+    PROFILE_END();
+
+    PROFILE_END();
     return game_screen_3d;
 }
 
-void game_draw_3d() {
+// Water only steps every few ticks, so it interpolates over the whole step instead of the last tick
+float GetWaterDrawMass(int x, int y, int z, float alpha) {
+    float t = fminf(((waterUpdateCounter % WATER_STEP_TICKS) + alpha) / WATER_STEP_TICKS, 1.0f);
+    int i = WATER_INDEX(x, y, z);
+    return Lerp(prev_mass[i], GetFluidMass(&water, i), t);
+}
+
+void DrawWaterStats(int x, int y) {
+    const FluidStats* stats = &water.stats;
+    DrawText(FrameFormat("water step %u: %.2f ms%s", stats->step, stats->stepTime * 1000, IsFluidAsleep(&water) ? ", asleep" : ""),
+        x, y, 20, BLACK);
+    DrawText(FrameFormat("mass %.2f, drift %+.4f, %d filled, %d active cells", stats->totalMass, stats->massDrift,
+        stats->filledCells, stats->activeCells), x, y + 24, 20, BLACK);
+    DrawText(FrameFormat("bricks: %d awake, %d stepped of %d, %d lakes of %d cells (R/F)", stats->awakeBricks,
+        stats->steppedBricks, water.brickCount, stats->lakes, stats->lakeCells), x, y + 48, 20, BLACK);
+    DrawText(FrameFormat("flow down %.2f (max %.2f), side %.2f (max %.2f), up %.2f (max %.2f), %d clamped",
+        stats->totalFlow[FLUID_FLOW_DOWN], stats->maxFlow[FLUID_FLOW_DOWN], stats->totalFlow[FLUID_FLOW_SIDE],
+        stats->maxFlow[FLUID_FLOW_SIDE], stats->totalFlow[FLUID_FLOW_UP], stats->maxFlow[FLUID_FLOW_UP], stats->clampedFlows),
+        x, y + 72, 20, BLACK);
+}
+
+void game_draw_3d(float alpha) {
+    PROFILE_BEGIN("game_draw_3d");
     ClearBackground(RAYWHITE);
 
-    BeginMode3D(camera);
+    Camera view = camera;
+    view.position = Vector3Lerp(prevCamera.position, camera.position, alpha);
+    view.target = Vector3Lerp(prevCamera.target, camera.target, alpha);
+
+    BeginMode3D(view);
 
-        Vector3 position = { 0.0f, 0.0f, 0.0f };
-        DrawModel(model, position, 1.0f, RED);
+        DrawTerrainLod(&terrain, &terrainSelection, texture, RED);
         // DrawModelWires(model, position, 1.0f, RED);
 
         DrawGrid(20, 1.0f);
@@ -349,24 +398,28 @@ void game_draw_3d() {
             for (int k = 0; k < WATER_L+2; k++) {
                 for (int j = 0; j < WATER_H+2; j++) {
                     Vector3 cubePos = Vector3Add((Vector3){i*BOX_SIZE, j*BOX_SIZE, k*BOX_SIZE}, mapPosition);
-                    if (water[i][j][k] == FILLED && mass[i][j][k] >= MinDraw) {
+                    float cell_mass = GetWaterDrawMass(i, j, k, alpha);
+                    if (water.cells[WATER_INDEX(i, j, k)] != FLUID_OCCUPIED && cell_mass >= MinDraw) {
                         float column_mass = 0.0f;
                         int column_height = 0;
                         for (int j1 = j - 1; j1 > 0; j1--) {
                             // calculate total water mass below current block;
-                            if (water[i][j1][k] == FILLED) {
-                                column_mass += mass[i][j1][k];
-                                column_height++;
-                            } else if (water[i][j1][k] == OCCUPIED) {
+                            if (water.cells[WATER_INDEX(i, j1, k)] == FLUID_OCCUPIED) {
                                 break;
                             }
+
+                            float below_mass = GetWaterDrawMass(i, j1, k, alpha);
+                            if (below_mass > water.params.minMass) {
+                                column_mass += below_mass;
+                                column_height++;
+                            }
                         }
 
                         // place box on top of the box below
                         float dy = Clamp(column_height * BOX_SIZE - column_mass * BOX_SIZE, 0, column_height * BOX_SIZE);
                         
                         // align vertically to the botton
-                        dy += BOX_SIZE - (BOX_SIZE * mass[i][j][k]) / 2.0f;
+                        dy += BOX_SIZE - (BOX_SIZE * cell_mass) / 2.0f;
                         cubePos = Vector3Subtract(cubePos, (Vector3){0, dy, 0});
                         Vector3 blueHSV = ColorToHSV(BLUE);
                         float colorValue = Remap((float)j / WATER_H, 0.0f, 1.0f, 0.3f, 0.6f);
@@ -374,7 +427,7 @@ void game_draw_3d() {
                         float sat = Remap((float)k / (WATER_L+2), 0, 1, 0.5, 1);
                         Color color = ColorFromHSV(hue, sat, colorValue);
                         // color.a = (unsigned char)(mass[i][j][k] * 255);
-                        DrawCube(cubePos, BOX_SIZE, BOX_SIZE * mass[i][j][k], BOX_SIZE, color);
+                        PushRenderCube(&waterQueue, 0, cubePos, (Vector3){ BOX_SIZE, BOX_SIZE * cell_mass, BOX_SIZE }, color);
                         // DrawCylinder(cubePos, BOX_SIZE, BOX_SIZE, BOX_SIZE * mass[i][j][k], 4, color);
                     // } else if (water[i][j][k] == OCCUPIED) {
                     //     DrawCubeWires(cubePos, BOX_SIZE, BOX_SIZE, BOX_SIZE, RED);
@@ -385,6 +438,8 @@ void game_draw_3d() {
             }
         }
 
+        FlushRenderQueue(&waterQueue);
+
         if (info.hit) {
             // printf("HIT %f %f %f; %f %f %f; %f %f %f!\n", info.triangle.p1.x, info.triangle.p1.y, info.triangle.p1.z, 
             //     info.triangle.p2.x, info.triangle.p2.y, info.triangle.p2.z, 
@@ -401,15 +456,25 @@ void game_draw_3d() {
     //     DrawText("No collision", 10, 42, 32, RED);
     // }
 
+    DrawText(FrameFormat("terrain: %d nodes, %d triangles", terrainSelection.count, terrainSelection.triangleCount), 10, 42, 20, BLACK);
+    DrawText(FrameFormat("water: %d cubes, %d batches, %s solver (M), stats (F3)", waterQueue.stats.commands, waterQueue.stats.batches,
+        water.solver == FLUID_SOLVER_PIPES ? "pipes" : "cellular"), 10, 66, 20, BLACK);
+    if (showWaterStats) {
+        DrawWaterStats(10, 90);
+    }
+
     DrawFPS(10, 10);
+    PROFILE_END();
 }
 
 void game_close_3d() {
-    printf("%s called\n", __FUNCTION__);
+    LOGI("%s called", __FUNCTION__);
 }
 
 screen_t game_screen_3d = {
     .name = 'GM3D',
+    .prepare = game_prepare_3d,
+    .load = game_load_3d,
     .init = game_init_3d,
     .update = game_update_3d,
     .draw = game_draw_3d,
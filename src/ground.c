@@ -0,0 +1,120 @@
+#include "ground.h"
+
+#include <math.h>
+
+#include "raymath.h"
+
+#include "noise.h"
+
+#define GROUND_NOISE_SCALE  64.0f
+
+void GenGroundPerlin(Ground* ground, float width, int segments, float baseY, float amplitude, unsigned int seed) {
+    SetPerlinSeed(seed);
+
+    if (ground->allocated < segments + 1) {
+        ground->allocated = segments + 1;
+        ground->points = (Vector2*)MemRealloc(ground->points, sizeof(Vector2) * ground->allocated);
+    }
+
+    ground->count = segments + 1;
+    for (int i = 0; i <= segments; i++) {
+        float x = width * i / segments;
+        // perlin() is 0.5 on every lattice point, sample between the rows
+        float noise = (perlin(x / GROUND_NOISE_SCALE, 0.5f)
+            + 0.5f * perlin(x / GROUND_NOISE_SCALE * 2, 1.5f)
+            + 0.25f * perlin(x / GROUND_NOISE_SCALE * 4, 2.5f))
+                / 1.75f;
+        ground->points[i] = (Vector2){x, baseY + (noise - 0.5f) * 2 * amplitude};
+    }
+}
+
+void UnloadGround(Ground* ground) {
+    MemFree(ground->points);
+    *ground = (Ground){0};
+}
+
+// First segment that ends at or after x
+static int LowerSegment(const Ground* ground, float x) {
+    int lo = 0;
+    int hi = ground->count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (ground->points[mid + 1].x < x) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+// Last segment that starts at or before x
+static int UpperSegment(const Ground* ground, float x) {
+    int lo = 0;
+    int hi = ground->count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (ground->points[mid].x <= x) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo - 1;
+}
+
+int GetGroundSegments(const Ground* ground, float minX, float maxX, int* first) {
+    if (ground->count < 2) {
+        return 0;
+    }
+
+    *first = LowerSegment(ground, minX);
+    int last = UpperSegment(ground, maxX);
+    return last >= *first ? last - *first + 1 : 0;
+}
+
+float GetGroundHeight(const Ground* ground, float x) {
+    if (x <= ground->points[0].x) {
+        return ground->points[0].y;
+    }
+
+    if (x >= ground->points[ground->count - 1].x) {
+        return ground->points[ground->count - 1].y;
+    }
+
+    Vector2 a = ground->points[LowerSegment(ground, x)];
+    Vector2 b = ground->points[LowerSegment(ground, x) + 1];
+    return Lerp(a.y, b.y, (x - a.x) / (b.x - a.x));
+}
+
+float GetGroundTop(const Ground* ground, float minX, float maxX) {
+    float top = fmin(GetGroundHeight(ground, minX), GetGroundHeight(ground, maxX));
+
+    int first;
+    int count = GetGroundSegments(ground, minX, maxX, &first);
+    // inner points only, the ends were interpolated above
+    for (int i = first + 1; i < first + count; i++) {
+        top = fmin(top, ground->points[i].y);
+    }
+
+    return top;
+}
+
+bool CheckCollisionLineGround(const Ground* ground, Vector2 start, Vector2 end, Vector2* collisionPoint) {
+    int first;
+    int count = GetGroundSegments(ground, fmin(start.x, end.x), fmax(start.x, end.x), &first);
+    for (int i = first; i < first + count; i++) {
+        if (CheckCollisionLines(ground->points[i], ground->points[i + 1], start, end, collisionPoint)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool CheckCollisionRecGround(const Ground* ground, Rectangle rec) {
+    // the ground is solid below the polyline, y grows downwards
+    return rec.y + rec.height > GetGroundTop(ground, rec.x, rec.x + rec.width);
+}
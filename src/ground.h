@@ -0,0 +1,30 @@
+#ifndef GROUND_H
+#define GROUND_H
+
+#include "raylib.h"
+
+// Polyline ground, x strictly increasing. Segment i goes from points[i] to points[i + 1],
+// so the points array doubles as an index of the segments sorted by x.
+typedef struct {
+    Vector2* points;
+    int count;
+    int allocated;
+} Ground;
+
+// segments + 1 points from x = 0 to width, y = baseY +- amplitude. Same seed, same ground.
+void GenGroundPerlin(Ground* ground, float width, int segments, float baseY, float amplitude, unsigned int seed);
+void UnloadGround(Ground* ground);
+
+// First and last segment overlapping [minX; maxX], returns the number of segments. O(log n).
+int GetGroundSegments(const Ground* ground, float minX, float maxX, int* first);
+// Ground y under x, clamped to the ends of the ground. O(log n).
+float GetGroundHeight(const Ground* ground, float x);
+// Highest point (smallest y) of the ground over [minX; maxX], where a building of that width rests
+float GetGroundTop(const Ground* ground, float minX, float maxX);
+
+// Only tests the segments under the line. O(log n + segments under the line).
+bool CheckCollisionLineGround(const Ground* ground, Vector2 start, Vector2 end, Vector2* collisionPoint);
+// True if any part of the rectangle is below the ground surface
+bool CheckCollisionRecGround(const Ground* ground, Rectangle rec);
+
+#endif /* GROUND_H */
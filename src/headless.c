@@ -0,0 +1,316 @@
+// Runs the colony simulation without a window, as fast as possible.
+// Used to check balance changes over thousands of ticks, e.g.
+//
+//   atlantis_headless --ticks 100000 --seed 42 --script build.txt --stats stats.csv
+//
+// Script lines, '#' starts a comment:
+//   <tick> <building> <x>          place a building on the ground at tick
+//   every <period> <building> <x>  place a building every period ticks
+//   <tick> platform <x> <y>        place a platform, skipped if its legs do not rest on anything
+// where building is house, power_plant, farm or concrete_factory and any coordinate can be '*' for a random one.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "raylib.h"
+
+#include "arena.h"
+#include "colony.h"
+#include "colony_render.h"
+#include "log.h"
+#include "profiler.h"
+
+#define ORDER_PLATFORM  LAST
+#define RANDOM_COORD    -1.0f
+
+typedef struct {
+    int tick;       // tick of a one-off order, period of a recurring one
+    int kind;       // BuildingType or ORDER_PLATFORM
+    float x;        // RANDOM_COORD picks a new random value every time the order runs
+    float y;
+} Order;
+
+typedef struct {
+    Order* items;
+    int count;
+    int allocated;
+} OrderList;
+
+typedef struct {
+    int ticks;
+    unsigned int seed;
+    bool seeded;
+    int interval;
+    const char* scriptPath;
+    const char* statsPath;
+    const char* profilePath;
+    bool renderStats;
+    bool keepGoing;
+} Options;
+
+static const char* kindNames[] = {
+    [HOUSE] = "house",
+    [POWER_PLANT] = "power_plant",
+    [CONCRETE_FACTORY] = "concrete_factory",
+    [FARM] = "farm",
+    [ORDER_PLATFORM] = "platform",
+};
+
+static void PushOrder(OrderList* list, Order order) {
+    if (list->count == list->allocated) {
+        list->allocated = list->allocated == 0 ? 16 : list->allocated * 2;
+        list->items = MemRealloc(list->items, sizeof(Order) * list->allocated);
+    }
+
+    list->items[list->count++] = order;
+}
+
+static int ParseKind(const char* name) {
+    for (int i = 0; i < ARR_SIZE(kindNames); i++) {
+        if (kindNames[i] != NULL && strcmp(kindNames[i], name) == 0) {
+            return i;
+        }
+    }
+
+    return BUILDING_INVALID;
+}
+
+static float ParseCoord(const char* text) {
+    if (text == NULL || strcmp(text, "*") == 0) {
+        return RANDOM_COORD;
+    }
+
+    return atof(text);
+}
+
+static int CompareOrders(const void* a, const void* b) {
+    return ((const Order*)a)->tick - ((const Order*)b)->tick;
+}
+
+static bool LoadScript(const char* path, OrderList* once, OrderList* recurring) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        printf("Unable to open script %s\n", path);
+        return false;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char* tokens[5] = {0};
+        int count = 0;
+        for (char* token = strtok(line, " \t\r\n"); token != NULL && count < ARR_SIZE(tokens); token = strtok(NULL, " \t\r\n")) {
+            tokens[count++] = token;
+        }
+        if (count == 0) {
+            continue;
+        }
+
+        bool every = strcmp(tokens[0], "every") == 0;
+        char** args = every ? tokens + 1 : tokens;
+        int argCount = every ? count - 1 : count;
+
+        Order order = {0};
+        order.kind = argCount >= 2 ? ParseKind(args[1]) : BUILDING_INVALID;
+        order.tick = argCount >= 1 ? atoi(args[0]) : 0;
+        if (order.kind == BUILDING_INVALID || argCount < 3 || (every && order.tick <= 0)) {
+            printf("%s:%d: unable to parse order\n", path, lineNumber);
+            fclose(file);
+            return false;
+        }
+        order.x = ParseCoord(args[2]);
+        order.y = ParseCoord(argCount >= 4 ? args[3] : NULL);
+
+        PushOrder(every ? recurring : once, order);
+    }
+
+    fclose(file);
+    qsort(once->items, once->count, sizeof(Order), CompareOrders);
+    return true;
+}
+
+static void RunOrder(Order order) {
+    int x = order.x == RANDOM_COORD ? GetRandomValue(0, BALANCE_MAP_WIDTH) : (int)order.x;
+
+    if (order.kind == ORDER_PLATFORM) {
+        int y = order.y == RANDOM_COORD ? GetRandomValue(0, SCREEN_HEIGHT) : (int)order.y;
+        Platform platform = GeneratePlatform(x, y, BALANCE_PLATFORM_WIDTH, 10, BALANCE_PLATFORM_LEG_LENGTH, 10, BALANCE_PLATFORM_ANGLE);
+        if (CheckPlatformSupport(platform)) {
+            AddPlatform(platform);
+        }
+    } else {
+        PlaceBuilding(order.kind, x);
+    }
+}
+
+static void WriteStats(FILE* stats) {
+    fprintf(stats, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%.2f\n",
+        g_gameTicks, g_totalFood, g_totalConcrete, g_totalPopulation, g_buildings.totals.housingCapacity,
+        g_powerRequired, g_powerCapacity, g_powerUsage, g_buildings.count, g_platformsCount, g_waterLevel);
+}
+
+// Queues the colony like the game screen does, without a GPU
+static void PrintRenderStats() {
+    RenderQueue queue = { .headless = true };
+    QueueColony(&queue, g_waterLevel);
+    FlushRenderQueue(&queue);
+    printf("render: %d commands, %d batches, %d without sorting\n",
+        queue.stats.commands, queue.stats.batches, queue.stats.immediateBatches);
+    UnloadRenderQueue(&queue);
+}
+
+static void PrintUsage(const char* program) {
+    printf("Usage: %s [--ticks N] [--seed S] [--script FILE] [--stats FILE] [--interval N] [--profile FILE] [--render-stats] [--keep-going]\n", program);
+    printf("  --ticks N       ticks to simulate, default 100000\n");
+    printf("  --seed S        random seed, default is time based\n");
+    printf("  --script FILE   build orders, see the top of headless.c\n");
+    printf("  --stats FILE    CSV output, '-' for stdout\n");
+    printf("  --interval N    ticks between CSV rows, default %d (one economy step)\n", BALANCE_ECONOMY_PERIOD);
+    printf("  --profile FILE  write a trace of the profiler zones and print a summary\n");
+    printf("  --render-stats  print the draw commands and batches of the final colony\n");
+    printf("  --keep-going    do not stop when the population reaches zero\n");
+}
+
+static bool ParseOptions(int argc, char const *argv[], Options* options) {
+    *options = (Options){
+        .ticks = 100000,
+        .interval = BALANCE_ECONOMY_PERIOD,
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--keep-going") == 0) {
+            options->keepGoing = true;
+            continue;
+        }
+        if (strcmp(arg, "--render-stats") == 0) {
+            options->renderStats = true;
+            continue;
+        }
+        if (strcmp(arg, "--help") == 0) {
+            return false;
+        }
+        bool known = strcmp(arg, "--ticks") == 0 || strcmp(arg, "--seed") == 0 || strcmp(arg, "--script") == 0
+            || strcmp(arg, "--stats") == 0 || strcmp(arg, "--interval") == 0 || strcmp(arg, "--profile") == 0;
+        if (!known) {
+            printf("Unknown option %s\n", arg);
+            return false;
+        }
+        if (value == NULL) {
+            printf("Missing value for %s\n", arg);
+            return false;
+        }
+
+        if (strcmp(arg, "--ticks") == 0) {
+            options->ticks = atoi(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            options->seed = strtoul(value, NULL, 10);
+            options->seeded = true;
+        } else if (strcmp(arg, "--script") == 0) {
+            options->scriptPath = value;
+        } else if (strcmp(arg, "--stats") == 0) {
+            options->statsPath = value;
+        } else if (strcmp(arg, "--profile") == 0) {
+            options->profilePath = value;
+        } else {
+            options->interval = atoi(value);
+        }
+        i++;
+    }
+
+    if (options->interval <= 0) {
+        options->interval = 1;
+    }
+
+    return true;
+}
+
+int main(int argc, char const *argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    SetRandomSeed(options.seeded ? options.seed : (unsigned int)time(NULL));
+
+    OrderList once = {0};
+    OrderList recurring = {0};
+    if (options.scriptPath != NULL && !LoadScript(options.scriptPath, &once, &recurring)) {
+        return 1;
+    }
+
+    FILE* stats = NULL;
+    if (options.statsPath != NULL) {
+        stats = strcmp(options.statsPath, "-") == 0 ? stdout : fopen(options.statsPath, "w");
+        if (stats == NULL) {
+            printf("Unable to open %s\n", options.statsPath);
+            return 1;
+        }
+        fprintf(stats, "tick,food,concrete,population,housing,power_required,power_capacity,power_usage,buildings,platforms,water_level\n");
+    }
+
+    InitLog();
+    InitColony();
+
+    clock_t start = clock();
+    int next = 0;
+    while (g_gameTicks < options.ticks) {
+        // orders for tick t run right before the simulation steps into it
+        int tick = g_gameTicks + 1;
+        for (; next < once.count && once.items[next].tick <= tick; next++) {
+            RunOrder(once.items[next]);
+        }
+        for (int i = 0; i < recurring.count; i++) {
+            if (tick % recurring.items[i].tick == 0) {
+                RunOrder(recurring.items[i]);
+            }
+        }
+
+        UpdateColony();
+
+        if (stats != NULL && g_gameTicks % options.interval == 0) {
+            WriteStats(stats);
+        }
+
+        if (g_totalPopulation <= 0 && !options.keepGoing) {
+            break;
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    fprintf(stderr, "%d ticks in %.3fs (%.0f ticks/s), population %d, buildings %d%s\n",
+        g_gameTicks, seconds, seconds > 0 ? g_gameTicks / seconds : 0.0, g_totalPopulation, g_buildings.count,
+        g_totalPopulation <= 0 ? ", game over" : "");
+
+    if (stats != NULL && stats != stdout) {
+        fclose(stats);
+    }
+    if (options.renderStats) {
+        PrintRenderStats();
+    }
+    if (options.profilePath != NULL) {
+        ExportProfilerTrace(options.profilePath);
+        PrintProfilerSummary();
+    }
+    CloseColony();
+    UnloadArena(&g_screenArena);
+    CloseLog();
+    MemFree(once.items);
+    MemFree(recurring.items);
+
+    return 0;
+}
@@ -0,0 +1,330 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "raylib.h"
+
+#include "const.h"
+#include "input.h"
+
+// File layout, native byte order:
+//   header: "ATIR", uint32 version, uint32 seed
+//   events: uint32 tick, uint8 type, payload
+// Events are only written for ticks where something was pressed or moved, and end with INPUT_EVENT_END.
+
+#define INPUT_FILE_MAGIC    "ATIR"
+#define INPUT_FILE_VERSION  1
+
+typedef enum {
+    INPUT_LIVE=0,
+    INPUT_RECORD,
+    INPUT_REPLAY
+} InputMode;
+
+typedef enum {
+    INPUT_EVENT_PRESSED=1,  // uint16 keys, uint8 buttons, bit i is trackedKeys[i] or mouse button i
+    INPUT_EVENT_MOUSE,      // float x, y
+    INPUT_EVENT_CAMERA,     // float position[3], target[3]
+    INPUT_EVENT_END
+} InputEventType;
+
+typedef struct {
+    uint32_t tick;
+    uint8_t type;
+    union {
+        struct {
+            uint16_t keys;
+            uint8_t buttons;
+        } pressed;
+        Vector2 mouse;
+        struct {
+            Vector3 position;
+            Vector3 target;
+        } camera;
+    };
+} InputEvent;
+
+static const int trackedKeys[] = {
+    KEY_ENTER,
+    KEY_P,
+    KEY_M,      // appended, so older recordings keep their bits
+    KEY_R,
+    KEY_F,
+};
+
+#define TRACKED_BUTTONS 3
+
+typedef struct {
+    InputMode mode;
+    FILE* file;
+    uint32_t tick;
+    bool started;
+    bool finished;
+
+    // pressed since the last tick, a frame may run zero or several ticks
+    uint16_t latchedKeys;
+    uint8_t latchedButtons;
+    Vector2 liveMouse;
+
+    uint16_t keys;
+    uint8_t buttons;
+    Vector2 mouse;
+
+    bool hasCamera;
+    Vector3 cameraPosition;
+    Vector3 cameraTarget;
+
+    bool hasPending;
+    InputEvent pending;
+} InputState;
+
+static InputState input;
+
+static size_t PayloadSize(uint8_t type) {
+    switch (type) {
+        case INPUT_EVENT_PRESSED: return sizeof(uint16_t) + sizeof(uint8_t);
+        case INPUT_EVENT_MOUSE: return 2 * sizeof(float);
+        case INPUT_EVENT_CAMERA: return 6 * sizeof(float);
+        default: return 0;
+    }
+}
+
+static void WriteEvent(InputEvent event) {
+    unsigned char payload[6 * sizeof(float)];
+    switch (event.type) {
+        case INPUT_EVENT_PRESSED:
+            memcpy(payload, &event.pressed.keys, sizeof(uint16_t));
+            memcpy(payload + sizeof(uint16_t), &event.pressed.buttons, sizeof(uint8_t));
+            break;
+        case INPUT_EVENT_MOUSE:
+            memcpy(payload, &event.mouse, 2 * sizeof(float));
+            break;
+        case INPUT_EVENT_CAMERA:
+            memcpy(payload, &event.camera.position, 3 * sizeof(float));
+            memcpy(payload + 3 * sizeof(float), &event.camera.target, 3 * sizeof(float));
+            break;
+        default:
+            break;
+    }
+
+    fwrite(&event.tick, sizeof(uint32_t), 1, input.file);
+    fwrite(&event.type, sizeof(uint8_t), 1, input.file);
+    fwrite(payload, 1, PayloadSize(event.type), input.file);
+}
+
+static bool ReadEvent(InputEvent* event) {
+    unsigned char payload[6 * sizeof(float)];
+    if (fread(&event->tick, sizeof(uint32_t), 1, input.file) != 1
+        || fread(&event->type, sizeof(uint8_t), 1, input.file) != 1
+        || event->type < INPUT_EVENT_PRESSED || event->type > INPUT_EVENT_END
+        || fread(payload, 1, PayloadSize(event->type), input.file) != PayloadSize(event->type)) {
+        return false;
+    }
+
+    switch (event->type) {
+        case INPUT_EVENT_PRESSED:
+            memcpy(&event->pressed.keys, payload, sizeof(uint16_t));
+            memcpy(&event->pressed.buttons, payload + sizeof(uint16_t), sizeof(uint8_t));
+            break;
+        case INPUT_EVENT_MOUSE:
+            memcpy(&event->mouse, payload, 2 * sizeof(float));
+            break;
+        case INPUT_EVENT_CAMERA:
+            memcpy(&event->camera.position, payload, 3 * sizeof(float));
+            memcpy(&event->camera.target, payload + 3 * sizeof(float), 3 * sizeof(float));
+            break;
+        default:
+            break;
+    }
+
+    return true;
+}
+
+static int TrackedKeyBit(int key) {
+    for (int i = 0; i < ARR_SIZE(trackedKeys); i++) {
+        if (trackedKeys[i] == key) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool StartInputRecording(const char* path, unsigned int seed) {
+    StopInput();
+
+    input.file = fopen(path, "wb");
+    if (input.file == NULL) {
+        printf("Unable to record input to %s\n", path);
+        return false;
+    }
+
+    uint32_t header[2] = {INPUT_FILE_VERSION, seed};
+    fwrite(INPUT_FILE_MAGIC, 1, 4, input.file);
+    fwrite(header, sizeof(uint32_t), 2, input.file);
+    input.mode = INPUT_RECORD;
+    return true;
+}
+
+bool StartInputReplay(const char* path, unsigned int* seed) {
+    StopInput();
+
+    input.file = fopen(path, "rb");
+    if (input.file == NULL) {
+        printf("Unable to open input recording %s\n", path);
+        return false;
+    }
+
+    char magic[4];
+    uint32_t header[2];
+    if (fread(magic, 1, 4, input.file) != 4 || memcmp(magic, INPUT_FILE_MAGIC, 4) != 0
+        || fread(header, sizeof(uint32_t), 2, input.file) != 2 || header[0] != INPUT_FILE_VERSION) {
+        printf("%s is not an input recording\n", path);
+        fclose(input.file);
+        input.file = NULL;
+        return false;
+    }
+
+    *seed = header[1];
+    input.mode = INPUT_REPLAY;
+    input.hasPending = ReadEvent(&input.pending);
+    return true;
+}
+
+void StopInput() {
+    if (input.file != NULL) {
+        if (input.mode == INPUT_RECORD) {
+            WriteEvent((InputEvent){ .tick = input.started ? input.tick + 1 : 0, .type = INPUT_EVENT_END });
+        }
+        fclose(input.file);
+    }
+
+    input = (InputState){0};
+}
+
+void PollInput() {
+    if (input.mode == INPUT_REPLAY) {
+        return;
+    }
+
+    for (int i = 0; i < ARR_SIZE(trackedKeys); i++) {
+        if (IsKeyPressed(trackedKeys[i])) {
+            input.latchedKeys |= 1 << i;
+        }
+    }
+    for (int i = 0; i < TRACKED_BUTTONS; i++) {
+        if (IsMouseButtonPressed(i)) {
+            input.latchedButtons |= 1 << i;
+        }
+    }
+    input.liveMouse = GetMousePosition();
+}
+
+void StepInput() {
+    bool first = !input.started;
+    input.tick = input.started ? input.tick + 1 : 0;
+    input.started = true;
+    input.keys = 0;
+    input.buttons = 0;
+
+    if (input.mode == INPUT_REPLAY) {
+        while (input.hasPending && input.pending.tick <= input.tick) {
+            InputEvent event = input.pending;
+            switch (event.type) {
+                case INPUT_EVENT_PRESSED:
+                    input.keys = event.pressed.keys;
+                    input.buttons = event.pressed.buttons;
+                    break;
+                case INPUT_EVENT_MOUSE:
+                    input.mouse = event.mouse;
+                    break;
+                case INPUT_EVENT_CAMERA:
+                    input.hasCamera = true;
+                    input.cameraPosition = event.camera.position;
+                    input.cameraTarget = event.camera.target;
+                    break;
+                case INPUT_EVENT_END:
+                    input.finished = true;
+                    break;
+            }
+            input.hasPending = ReadEvent(&input.pending);
+        }
+
+        // a recording cut short still replays up to where it stops
+        if (!input.hasPending) {
+            input.finished = true;
+        }
+        return;
+    }
+
+    input.keys = input.latchedKeys;
+    input.buttons = input.latchedButtons;
+    input.latchedKeys = 0;
+    input.latchedButtons = 0;
+    bool mouseMoved = first || input.liveMouse.x != input.mouse.x || input.liveMouse.y != input.mouse.y;
+    input.mouse = input.liveMouse;
+
+    if (input.mode == INPUT_RECORD) {
+        if (input.keys != 0 || input.buttons != 0) {
+            WriteEvent((InputEvent){ .tick = input.tick, .type = INPUT_EVENT_PRESSED, .pressed = { input.keys, input.buttons } });
+        }
+        if (mouseMoved) {
+            WriteEvent((InputEvent){ .tick = input.tick, .type = INPUT_EVENT_MOUSE, .mouse = input.mouse });
+        }
+    }
+}
+
+bool IsInputReplaying() {
+    return input.mode == INPUT_REPLAY;
+}
+
+bool IsInputReplayFinished() {
+    return input.mode == INPUT_REPLAY && input.finished;
+}
+
+bool IsInputKeyPressed(int key) {
+    int bit = TrackedKeyBit(key);
+    if (bit < 0) {
+        // not recorded, so never seen while replaying
+        return input.mode != INPUT_REPLAY && IsKeyPressed(key);
+    }
+
+    return (input.keys & (1 << bit)) != 0;
+}
+
+bool IsInputMouseButtonPressed(int button) {
+    if (button < 0 || button >= TRACKED_BUTTONS) {
+        return false;
+    }
+
+    return (input.buttons & (1 << button)) != 0;
+}
+
+Vector2 GetInputMousePosition() {
+    return input.mouse;
+}
+
+void UpdateInputCamera(Camera* camera) {
+    if (input.mode == INPUT_REPLAY) {
+        if (input.hasCamera) {
+            camera->position = input.cameraPosition;
+            camera->target = input.cameraTarget;
+        }
+        return;
+    }
+
+    UpdateCamera(camera);
+
+    if (input.mode == INPUT_RECORD) {
+        bool moved = !input.hasCamera
+            || memcmp(&camera->position, &input.cameraPosition, sizeof(Vector3)) != 0
+            || memcmp(&camera->target, &input.cameraTarget, sizeof(Vector3)) != 0;
+        if (moved) {
+            input.hasCamera = true;
+            input.cameraPosition = camera->position;
+            input.cameraTarget = camera->target;
+            WriteEvent((InputEvent){ .tick = input.tick, .type = INPUT_EVENT_CAMERA,
+                .camera = { camera->position, camera->target } });
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "raylib.h"
+
+// Screens read input through here instead of raylib, so a session can be recorded to a file and
+// replayed tick by tick. Only the keys in the table at the top of input.c are recorded.
+
+bool StartInputRecording(const char* path, unsigned int seed);
+// Fills seed with the one the recording was made with, the caller passes it to SetRandomSeed()
+bool StartInputReplay(const char* path, unsigned int* seed);
+void StopInput();
+
+// Call once per frame, collects presses until the next tick picks them up
+void PollInput();
+// Call before every simulation tick, the queries below answer for that tick
+void StepInput();
+bool IsInputReplaying();
+bool IsInputReplayFinished();
+
+bool IsInputKeyPressed(int key);
+bool IsInputMouseButtonPressed(int button);
+Vector2 GetInputMousePosition();
+// UpdateCamera() when live, the recorded camera pose when replaying
+void UpdateInputCamera(Camera* camera);
+
+#endif /* INPUT_H */
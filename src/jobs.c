@@ -0,0 +1,460 @@
+#include "jobs.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#if !defined(PLATFORM_WEB)
+    #include <pthread.h>
+    #include <sched.h>
+    #if !defined(_WIN32)
+        #include <unistd.h>
+    #endif
+#endif
+
+#include "raylib.h"
+
+#include "platform.h"
+
+#define JOBS_SPINS  64      // failed searches for work before a worker sleeps
+
+struct Job {
+    JobFunc func;
+    JobRangeFunc rangeFunc;     // chunk of a ParallelFor(), func is NULL
+    void* data;
+    int first;
+    int last;
+    Job* parent;                // done once this job is
+    atomic_int unfinished;      // the job itself and its unfinished chunks
+    atomic_int dependencies;    // jobs to finish before it is queued, plus one until it is submitted
+    atomic_int references;      // the pool until the job is done, the handle, and every job it waits for
+    atomic_bool done;
+
+    atomic_flag lock;           // guards the continuations
+    Job** continuations;        // jobs waiting for this one
+    int continuationCount;
+    int continuationAllocated;
+};
+
+// Chase-Lev deque, the owner works at the bottom, thieves take from the top
+typedef struct {
+    _Atomic int64_t top;
+    _Atomic int64_t bottom;
+    Job* _Atomic jobs[JOBS_DEQUE_SIZE];
+} JobDeque;
+
+typedef struct {
+    int workerCount;            // 0 runs every job inline
+    JobDeque* deques;
+
+#if !defined(PLATFORM_WEB)
+    pthread_t threads[JOBS_MAX_WORKERS];
+    int threadCount;            // started, the calling thread included
+    atomic_bool running;
+
+    // jobs queued by threads outside the pool, FIFO
+    pthread_mutex_t queueLock;
+    Job** queue;
+    int queueHead;
+    int queueCount;
+    int queueAllocated;
+    atomic_int queued;
+
+    // idle workers sleep until the epoch moves, every queued job moves it
+    pthread_mutex_t sleepLock;
+    pthread_cond_t wake;
+    atomic_uint epoch;
+    atomic_int sleepers;
+#endif
+} JobPool;
+
+static JobPool pool;
+static THREAD_LOCAL int workerIndex = -1;
+static THREAD_LOCAL uint32_t stealSeed;
+
+static Job* NewJob() {
+    Job* job = MemAlloc(sizeof(Job));
+    atomic_init(&job->unfinished, 1);
+    atomic_init(&job->dependencies, 1);
+    atomic_init(&job->references, 1);
+    atomic_init(&job->done, false);
+    atomic_flag_clear(&job->lock);
+    return job;
+}
+
+static void ReleaseJobReference(Job* job) {
+    if (atomic_fetch_sub(&job->references, 1) == 1) {
+        MemFree(job->continuations);
+        MemFree(job);
+    }
+}
+
+// Sequentially consistent throughout, the owner and a thief racing for the last job must see each other's write
+static void PushDeque(JobDeque* deque, Job* job, bool* full) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load(&deque->top);
+    if (bottom - top >= JOBS_DEQUE_SIZE) {
+        *full = true;
+        return;
+    }
+
+    atomic_store_explicit(&deque->jobs[bottom & (JOBS_DEQUE_SIZE - 1)], job, memory_order_relaxed);
+    atomic_store(&deque->bottom, bottom + 1);
+    *full = false;
+}
+
+// Owner only
+static Job* PopDeque(JobDeque* deque) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store(&deque->bottom, bottom);
+    int64_t top = atomic_load(&deque->top);
+
+    if (top > bottom) {
+        atomic_store(&deque->bottom, bottom + 1);
+        return NULL;
+    }
+
+    Job* job = atomic_load_explicit(&deque->jobs[bottom & (JOBS_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (top == bottom) {
+        // the last job, race the thieves for it
+        if (!atomic_compare_exchange_strong(&deque->top, &top, top + 1)) {
+            job = NULL;
+        }
+        atomic_store(&deque->bottom, bottom + 1);
+    }
+    return job;
+}
+
+static Job* StealDeque(JobDeque* deque) {
+    int64_t top = atomic_load(&deque->top);
+    int64_t bottom = atomic_load(&deque->bottom);
+    if (top >= bottom) {
+        return NULL;
+    }
+
+    Job* job = atomic_load_explicit(&deque->jobs[top & (JOBS_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong(&deque->top, &top, top + 1)) {
+        return NULL;
+    }
+    return job;
+}
+
+static void RunJob(Job* job);
+
+// Queues a job whose dependencies are done
+static void EnqueueJob(Job* job) {
+    if (pool.workerCount == 0) {
+        RunJob(job);
+        return;
+    }
+
+#if !defined(PLATFORM_WEB)
+    if (workerIndex >= 0) {
+        bool full;
+        PushDeque(&pool.deques[workerIndex], job, &full);
+        if (full) {
+            RunJob(job);
+            return;
+        }
+    } else {
+        pthread_mutex_lock(&pool.queueLock);
+        if (pool.queueCount == pool.queueAllocated) {
+            int allocated = pool.queueAllocated == 0 ? 64 : pool.queueAllocated * 2;
+            Job** queue = MemAlloc(sizeof(Job*) * allocated);
+            for (int i = 0; i < pool.queueCount; i++) {
+                queue[i] = pool.queue[(pool.queueHead + i) % pool.queueAllocated];
+            }
+            MemFree(pool.queue);
+            pool.queue = queue;
+            pool.queueHead = 0;
+            pool.queueAllocated = allocated;
+        }
+        pool.queue[(pool.queueHead + pool.queueCount) % pool.queueAllocated] = job;
+        pool.queueCount++;
+        atomic_fetch_add(&pool.queued, 1);
+        pthread_mutex_unlock(&pool.queueLock);
+    }
+
+    atomic_fetch_add(&pool.epoch, 1);
+    if (atomic_load(&pool.sleepers) > 0) {
+        pthread_mutex_lock(&pool.sleepLock);
+        pthread_cond_broadcast(&pool.wake);
+        pthread_mutex_unlock(&pool.sleepLock);
+    }
+#endif
+}
+
+static void ReleaseDependency(Job* job) {
+    if (atomic_fetch_sub(&job->dependencies, 1) == 1) {
+        EnqueueJob(job);
+    }
+}
+
+static void FinishJob(Job* job) {
+    if (atomic_fetch_sub(&job->unfinished, 1) != 1) {
+        return;
+    }
+
+    // no continuation can be added once done is set under the lock
+    while (atomic_flag_test_and_set(&job->lock)) {}
+    atomic_store(&job->done, true);
+    atomic_flag_clear(&job->lock);
+
+    for (int i = 0; i < job->continuationCount; i++) {
+        Job* continuation = job->continuations[i];
+        ReleaseDependency(continuation);
+        ReleaseJobReference(continuation);
+    }
+
+    Job* parent = job->parent;
+    ReleaseJobReference(job);
+    if (parent != NULL) {
+        FinishJob(parent);
+    }
+}
+
+static void RunJob(Job* job) {
+    if (job->rangeFunc != NULL) {
+        job->rangeFunc(job->first, job->last, job->data);
+    } else if (job->func != NULL) {
+        job->func(job->data);
+    }
+    FinishJob(job);
+}
+
+// Own deque first, then the shared queue, then the others' deques from a random one
+static Job* FindJob() {
+#if !defined(PLATFORM_WEB)
+    if (pool.workerCount == 0) {
+        return NULL;
+    }
+
+    if (workerIndex >= 0) {
+        Job* job = PopDeque(&pool.deques[workerIndex]);
+        if (job != NULL) {
+            return job;
+        }
+    }
+
+    if (atomic_load(&pool.queued) > 0) {
+        Job* job = NULL;
+        pthread_mutex_lock(&pool.queueLock);
+        if (pool.queueCount > 0) {
+            job = pool.queue[pool.queueHead];
+            pool.queueHead = (pool.queueHead + 1) % pool.queueAllocated;
+            pool.queueCount--;
+            atomic_fetch_sub(&pool.queued, 1);
+        }
+        pthread_mutex_unlock(&pool.queueLock);
+        if (job != NULL) {
+            return job;
+        }
+    }
+
+    stealSeed = stealSeed * 1664525u + 1013904223u;
+    int start = (stealSeed >> 16) % pool.workerCount;
+    for (int i = 0; i < pool.workerCount; i++) {
+        int victim = (start + i) % pool.workerCount;
+        if (victim == workerIndex) {
+            continue;
+        }
+        Job* job = StealDeque(&pool.deques[victim]);
+        if (job != NULL) {
+            return job;
+        }
+    }
+#endif
+
+    return NULL;
+}
+
+#if !defined(PLATFORM_WEB)
+static void* RunWorker(void* arg) {
+    workerIndex = (int)(intptr_t)arg;
+    stealSeed = (uint32_t)workerIndex * 2654435761u;
+
+    int spins = 0;
+    while (atomic_load(&pool.running)) {
+        unsigned int epoch = atomic_load(&pool.epoch);
+        Job* job = FindJob();
+        if (job != NULL) {
+            RunJob(job);
+            spins = 0;
+            continue;
+        }
+        if (++spins < JOBS_SPINS) {
+            sched_yield();
+            continue;
+        }
+
+        // anything queued after epoch was read moved it, so the worker does not sleep through it
+        pthread_mutex_lock(&pool.sleepLock);
+        atomic_fetch_add(&pool.sleepers, 1);
+        while (atomic_load(&pool.running) && atomic_load(&pool.epoch) == epoch) {
+            pthread_cond_wait(&pool.wake, &pool.sleepLock);
+        }
+        atomic_fetch_sub(&pool.sleepers, 1);
+        pthread_mutex_unlock(&pool.sleepLock);
+        spins = 0;
+    }
+
+    return NULL;
+}
+
+static int GetCoreCount() {
+#if defined(_WIN32)
+    return pthread_num_processors_np();
+#else
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+#endif
+
+void InitJobs(int workers) {
+    pool = (JobPool){0};
+
+#if !defined(PLATFORM_WEB)
+    if (workers <= 0) {
+        workers = GetCoreCount();
+    }
+    if (workers > JOBS_MAX_WORKERS) {
+        workers = JOBS_MAX_WORKERS;
+    }
+    // a single thread gains nothing from the pool
+    if (workers <= 1) {
+        return;
+    }
+
+    pool.deques = MemAlloc(sizeof(JobDeque) * workers);
+    pthread_mutex_init(&pool.queueLock, NULL);
+    pthread_mutex_init(&pool.sleepLock, NULL);
+    pthread_cond_init(&pool.wake, NULL);
+    atomic_store(&pool.running, true);
+
+    // set before the threads start, the deques of workers that fail to start just stay empty
+    workerIndex = 0;
+    stealSeed = 1;
+    pool.workerCount = workers;
+    pool.threadCount = 1;
+    for (int i = 1; i < workers; i++) {
+        if (pthread_create(&pool.threads[i], NULL, RunWorker, (void*)(intptr_t)i) != 0) {
+            printf("Unable to start job worker %d, running with %d\n", i, pool.threadCount);
+            break;
+        }
+        pool.threadCount++;
+    }
+#endif
+}
+
+void CloseJobs() {
+#if !defined(PLATFORM_WEB)
+    if (pool.workerCount == 0) {
+        return;
+    }
+
+    atomic_store(&pool.running, false);
+    pthread_mutex_lock(&pool.sleepLock);
+    atomic_fetch_add(&pool.epoch, 1);
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.sleepLock);
+    for (int i = 1; i < pool.threadCount; i++) {
+        pthread_join(pool.threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool.queueLock);
+    pthread_mutex_destroy(&pool.sleepLock);
+    pthread_cond_destroy(&pool.wake);
+    MemFree(pool.deques);
+    MemFree(pool.queue);
+    workerIndex = -1;
+#endif
+    pool = (JobPool){0};
+}
+
+int GetJobWorkerCount() {
+    return pool.workerCount > 0 ? pool.workerCount : 1;
+}
+
+Job* CreateJob(JobFunc func, void* data) {
+    Job* job = NewJob();
+    job->func = func;
+    job->data = data;
+    atomic_fetch_add(&job->references, 1);      // the handle
+    return job;
+}
+
+void AddJobDependency(Job* job, Job* before) {
+    while (atomic_flag_test_and_set(&before->lock)) {}
+    if (atomic_load(&before->done)) {
+        atomic_flag_clear(&before->lock);
+        return;
+    }
+
+    if (before->continuationCount == before->continuationAllocated) {
+        before->continuationAllocated = before->continuationAllocated == 0 ? 4 : before->continuationAllocated * 2;
+        before->continuations = MemRealloc(before->continuations, sizeof(Job*) * before->continuationAllocated);
+    }
+    before->continuations[before->continuationCount++] = job;
+    atomic_fetch_add(&job->dependencies, 1);
+    atomic_fetch_add(&job->references, 1);
+    atomic_flag_clear(&before->lock);
+}
+
+void SubmitJob(Job* job) {
+    ReleaseDependency(job);
+}
+
+Job* StartJob(JobFunc func, void* data) {
+    Job* job = CreateJob(func, data);
+    SubmitJob(job);
+    return job;
+}
+
+bool IsJobDone(Job* job) {
+    return atomic_load(&job->done);
+}
+
+void WaitJob(Job* job) {
+    while (!atomic_load(&job->done)) {
+        Job* other = FindJob();
+        if (other != NULL) {
+            RunJob(other);
+        } else {
+#if !defined(PLATFORM_WEB)
+            sched_yield();
+#endif
+        }
+    }
+    ReleaseJobReference(job);
+}
+
+void ReleaseJob(Job* job) {
+    ReleaseJobReference(job);
+}
+
+Job* StartParallelFor(int first, int last, int grain, JobRangeFunc func, void* data) {
+    if (grain < 1) {
+        grain = 1;
+    }
+
+    Job* parent = CreateJob(NULL, NULL);
+    atomic_store(&parent->dependencies, 0);     // never queued, the chunks finish it
+    for (int chunk = first; chunk < last; chunk += grain) {
+        Job* job = NewJob();
+        job->rangeFunc = func;
+        job->data = data;
+        job->first = chunk;
+        job->last = chunk + grain < last ? chunk + grain : last;
+        job->parent = parent;
+        atomic_fetch_add(&parent->unfinished, 1);
+        atomic_store(&job->dependencies, 0);
+        EnqueueJob(job);
+    }
+
+    FinishJob(parent);
+    return parent;
+}
+
+void ParallelFor(int first, int last, int grain, JobRangeFunc func, void* data) {
+    WaitJob(StartParallelFor(first, last, grain, func, data));
+}
@@ -0,0 +1,52 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+
+// Work stealing job pool shared by every subsystem. Each worker thread owns a deque, pushes and pops its own
+// jobs at the bottom and steals from the top of the others' when it runs dry. Threads outside the pool, like
+// the loading thread, queue into a shared list instead.
+//
+//   Job* mesh = StartJob(BuildMesh, &terrain);
+//   Job* voxels = CreateJob(Voxelize, &terrain);
+//   AddJobDependency(voxels, mesh);     // runs once mesh is done
+//   SubmitJob(voxels);
+//   ReleaseJob(mesh);
+//   ...
+//   if (IsJobDone(voxels)) WaitJob(voxels);
+//
+// Waiting runs other jobs instead of blocking. Without InitJobs() or threads, as on the web build, jobs run
+// inline as soon as they are ready.
+
+#define JOBS_MAX_WORKERS    32      // the thread calling InitJobs() included
+#define JOBS_DEQUE_SIZE     4096    // jobs queued per worker, power of two, pushing to a full one runs the job inline
+
+typedef void (*JobFunc)(void* data);
+// Gets a chunk [first; last) of a ParallelFor() range
+typedef void (*JobRangeFunc)(int first, int last, void* data);
+
+typedef struct Job Job;
+
+// workers counts the calling thread, which becomes worker 0. 0 or less uses one per core.
+void InitJobs(int workers);
+// Every job must be done
+void CloseJobs();
+int GetJobWorkerCount();
+
+// Handles stay valid until passed to WaitJob() or ReleaseJob()
+Job* CreateJob(JobFunc func, void* data);   // not queued until SubmitJob()
+// job waits for before to finish. Call before submitting job.
+void AddJobDependency(Job* job, Job* before);
+void SubmitJob(Job* job);
+Job* StartJob(JobFunc func, void* data);    // CreateJob() and SubmitJob()
+
+bool IsJobDone(Job* job);
+// Runs queued jobs until job is done, then releases it. Safe from any thread.
+void WaitJob(Job* job);
+void ReleaseJob(Job* job);
+
+// Splits [first; last) into chunks of grain items, the job is done once every chunk is
+Job* StartParallelFor(int first, int last, int grain, JobRangeFunc func, void* data);
+void ParallelFor(int first, int last, int grain, JobRangeFunc func, void* data);
+
+#endif /* JOBS_H */
@@ -0,0 +1,106 @@
+#include <stdatomic.h>
+#include <stdio.h>
+
+#if !defined(PLATFORM_WEB)
+    #include <pthread.h>
+#endif
+
+#include "raylib.h"
+
+#include "const.h"
+#include "loading_screen.h"
+#include "log.h"
+#include "profiler.h"
+
+screen_t pendingScreen;
+atomic_bool loadDone;
+atomic_int loadProgress;                // per mille, atomics on floats are not portable
+const char* _Atomic loadStage;
+
+#if !defined(PLATFORM_WEB)
+pthread_t loadThread;
+bool loadThreadRunning;
+
+void* RunScreenLoad(void* arg) {
+    pendingScreen.load();
+    ProfileThreadExit();
+    atomic_store(&loadDone, true);
+    return NULL;
+}
+#endif
+
+void SetLoadingProgress(float progress, const char* stage) {
+    atomic_store(&loadProgress, (int)(progress * 1000));
+    atomic_store(&loadStage, stage);
+}
+
+void StartScreenLoad(screen_t screen) {
+    if (screen.prepare != NULL) {
+        screen.prepare();
+    }
+    pendingScreen = screen;
+    atomic_store(&loadDone, false);
+    SetLoadingProgress(0.0f, "Loading");
+
+#if !defined(PLATFORM_WEB)
+    if (pthread_create(&loadThread, NULL, RunScreenLoad, NULL) == 0) {
+        loadThreadRunning = true;
+        return;
+    }
+    printf("Unable to start the loading thread, loading on the main thread\n");
+#endif
+
+    // no threads on the web build, the frame blocks like before
+    screen.load();
+    atomic_store(&loadDone, true);
+}
+
+void WaitScreenLoad() {
+#if !defined(PLATFORM_WEB)
+    if (loadThreadRunning) {
+        pthread_join(loadThread, NULL);
+        loadThreadRunning = false;
+    }
+#endif
+}
+
+void loading_init() {
+    LOGI("%s called", __FUNCTION__);
+}
+
+screen_t loading_update() {
+    if (atomic_load(&loadDone)) {
+        WaitScreenLoad();
+        return pendingScreen;
+    }
+
+    return loading_screen;
+}
+
+void loading_draw(float alpha) {
+    float progress = atomic_load(&loadProgress) / 1000.0f;
+    const char* stage = atomic_load(&loadStage);
+
+    int width = SCREEN_WIDTH / 2;
+    int x = (SCREEN_WIDTH - width) / 2;
+    int y = SCREEN_HEIGHT / 2;
+
+    ClearBackground(RAYWHITE);
+    DrawText(stage, x, y - 30, 20, BLACK);
+    DrawRectangle(x, y, (int)(width * progress), 20, BLUE);
+    DrawRectangleLines(x, y, width, 20, BLACK);
+}
+
+void loading_close() {
+    // also reached when the window closes mid load, the worker must not outlive the program
+    WaitScreenLoad();
+    LOGI("%s called", __FUNCTION__);
+}
+
+screen_t loading_screen = {
+    .name = 'LOAD',
+    .init = loading_init,
+    .update = loading_update,
+    .draw = loading_draw,
+    .close = loading_close
+};
@@ -0,0 +1,13 @@
+#ifndef LOADING_SCREEN_H
+#define LOADING_SCREEN_H
+
+#include "screen.h"
+
+// Shown while a screen's load() runs on a worker thread, switches to that screen once it returns
+extern screen_t loading_screen;
+
+void StartScreenLoad(screen_t screen);
+// For load() functions, progress in [0; 1]. stage must outlive the load.
+void SetLoadingProgress(float progress, const char* stage);
+
+#endif /* LOADING_SCREEN_H */
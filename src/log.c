@@ -0,0 +1,149 @@
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#if !defined(PLATFORM_WEB)
+    #include <pthread.h>
+#endif
+
+#include "log.h"
+
+#define LOG_IDLE_SLEEP_NS   1000000     // writer sleep when the ring is empty
+
+typedef struct {
+    atomic_size_t sequence;
+    int level;
+    char text[LOG_MESSAGE_SIZE];
+} LogCell;
+
+// Bounded multi-producer queue after Dmitry Vyukov's: a cell is free for position pos when its sequence
+// equals pos, and holds a message once the producer sets it to pos + 1. The single writer thread hands
+// it back for the next lap by setting pos + LOG_QUEUE_SIZE.
+static LogCell cells[LOG_QUEUE_SIZE];
+static atomic_size_t enqueuePos;
+static size_t dequeuePos;       // writer thread only
+static atomic_int dropped;
+static atomic_bool running;
+
+static const char* levelNames[] = { "TRACE", "DEBUG", "INFO", "WARNING", "ERROR" };
+
+static void WriteMessage(int level, const char* text) {
+    printf("%s: %s\n", levelNames[level], text);
+}
+
+void LogWrite(int level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    if (!atomic_load_explicit(&running, memory_order_acquire)) {
+        char text[LOG_MESSAGE_SIZE];
+        vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        WriteMessage(level, text);
+        return;
+    }
+
+    LogCell* cell;
+    size_t pos = atomic_load_explicit(&enqueuePos, memory_order_relaxed);
+    for (;;) {
+        cell = &cells[pos & (LOG_QUEUE_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueuePos, &pos, pos + 1,
+                memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // full, the writer is a lap behind
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            va_end(args);
+            return;
+        } else {
+            pos = atomic_load_explicit(&enqueuePos, memory_order_relaxed);
+        }
+    }
+
+    cell->level = level;
+    vsnprintf(cell->text, sizeof(cell->text), format, args);
+    va_end(args);
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+}
+
+// Writes the queued messages in order, returns how many
+static int DrainLog() {
+    int count = 0;
+    for (;;) {
+        LogCell* cell = &cells[dequeuePos & (LOG_QUEUE_SIZE - 1)];
+        if (atomic_load_explicit(&cell->sequence, memory_order_acquire) != dequeuePos + 1) {
+            break;
+        }
+
+        WriteMessage(cell->level, cell->text);
+        atomic_store_explicit(&cell->sequence, dequeuePos + LOG_QUEUE_SIZE, memory_order_release);
+        dequeuePos++;
+        count++;
+    }
+
+    int lost = atomic_exchange_explicit(&dropped, 0, memory_order_relaxed);
+    if (lost > 0) {
+        printf("WARNING: log queue full, %d messages dropped\n", lost);
+    }
+    if (count > 0) {
+        fflush(stdout);
+    }
+
+    return count;
+}
+
+#if !defined(PLATFORM_WEB)
+static pthread_t writerThread;
+static atomic_bool stopping;
+
+static void* RunLogWriter(void* arg) {
+    while (!atomic_load(&stopping)) {
+        if (DrainLog() == 0) {
+            struct timespec idle = { 0, LOG_IDLE_SLEEP_NS };
+            nanosleep(&idle, NULL);
+        }
+    }
+    DrainLog();
+    return NULL;
+}
+#endif
+
+void InitLog() {
+#if !defined(PLATFORM_WEB)
+    if (atomic_load(&running)) {
+        return;
+    }
+
+    for (size_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+        atomic_store_explicit(&cells[i].sequence, i, memory_order_relaxed);
+    }
+    atomic_store(&enqueuePos, 0);
+    dequeuePos = 0;
+    atomic_store(&stopping, false);
+
+    if (pthread_create(&writerThread, NULL, RunLogWriter, NULL) != 0) {
+        printf("WARNING: unable to start the log thread, logging synchronously\n");
+        return;
+    }
+    atomic_store_explicit(&running, true, memory_order_release);
+#endif
+}
+
+void CloseLog() {
+#if !defined(PLATFORM_WEB)
+    if (!atomic_load(&running)) {
+        return;
+    }
+
+    // later calls write directly, the ones already in the ring are drained before the thread exits
+    atomic_store_explicit(&running, false, memory_order_release);
+    atomic_store(&stopping, true);
+    pthread_join(writerThread, NULL);
+#endif
+}
@@ -0,0 +1,66 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+
+// Buffered logging for the game loop. Calls below LOG_MIN_LEVEL compile to nothing, their arguments are not
+// evaluated. Enabled calls format into a lock-free ring and return, a background thread writes them to stdout.
+// When the ring is full the message is dropped and counted instead of waiting.
+//
+//   LOGD("Generate: %d %d", x, y);     // no trailing newline
+//
+// Before InitLog(), after CloseLog() and on the web build messages are written right away.
+
+#define LOG_LEVEL_TRACE     0
+#define LOG_LEVEL_DEBUG     1
+#define LOG_LEVEL_INFO      2
+#define LOG_LEVEL_WARNING   3
+#define LOG_LEVEL_ERROR     4
+#define LOG_LEVEL_NONE      5
+
+// -DATLANTIS_LOG_LEVEL=<n> in CMake overrides the default
+#if !defined(LOG_MIN_LEVEL)
+    #if defined(NDEBUG)
+        #define LOG_MIN_LEVEL LOG_LEVEL_INFO
+    #else
+        #define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+    #endif
+#endif
+
+#define LOG_QUEUE_SIZE      1024    // messages, power of two
+#define LOG_MESSAGE_SIZE    192     // longer messages are truncated
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_TRACE
+    #define LOGT(...) LogWrite(LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+    #define LOGT(...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+    #define LOGD(...) LogWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+    #define LOGD(...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+    #define LOGI(...) LogWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+    #define LOGI(...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARNING
+    #define LOGW(...) LogWrite(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+    #define LOGW(...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+    #define LOGE(...) LogWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+    #define LOGE(...) ((void)0)
+#endif
+
+// Starts the writer thread
+void InitLog();
+// Writes everything still queued and stops the thread
+void CloseLog();
+
+void LogWrite(int level, const char* format, ...);
+
+#endif /* LOG_H */
@@ -1,5 +1,8 @@
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #if defined(PLATFORM_WEB)
     #include <emscripten/emscripten.h>
@@ -7,34 +10,155 @@
 
 #include "raylib.h"
 
+#include "arena.h"
 #include "const.h"
 #include "screen.h"
 #include "game_screen.h"
 #include "game_over_screen.h"
 #include "game_screen_3d.h"
+#include "input.h"
+#include "jobs.h"
+#include "loading_screen.h"
+#include "log.h"
+#include "profiler.h"
+
+#define SIM_TICKS_PER_SECOND    30
+#define SIM_MAX_TICKS_PER_FRAME 5       // after a long stall the simulation slows down instead of spiralling
+#define RENDER_FPS              60
+
+typedef struct {
+    double* samples;    // seconds
+    int count;
+    int allocated;
+} FrameCosts;
 
 screen_t current_screen;
 RenderTexture2D target;
 
+double simAccumulator;     // real time not yet simulated, seconds
+double lastFrameTime;
+
+// Only collected while replaying, so a replay doubles as a benchmark. Update cost is the sum of the frame's ticks.
+FrameCosts updateCosts;
+FrameCosts drawCosts;
+
+void AddFrameCost(FrameCosts* costs, double seconds) {
+    if (costs->count == costs->allocated) {
+        costs->allocated = costs->allocated == 0 ? 1024 : costs->allocated * 2;
+        costs->samples = MemRealloc(costs->samples, sizeof(double) * costs->allocated);
+    }
+
+    costs->samples[costs->count++] = seconds;
+}
+
+int CompareCosts(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+void PrintFrameCosts(const char* name, FrameCosts* costs) {
+    if (costs->count == 0) {
+        return;
+    }
+
+    double total = 0;
+    for (int i = 0; i < costs->count; i++) {
+        total += costs->samples[i];
+    }
+    qsort(costs->samples, costs->count, sizeof(double), CompareCosts);
+
+    double* sorted = costs->samples;
+    int n = costs->count;
+    printf("%-6s avg %.3fms  p50 %.3fms  p95 %.3fms  p99 %.3fms  max %.3fms\n", name,
+        total / n * 1000, sorted[n / 2] * 1000, sorted[n * 95 / 100] * 1000, sorted[n * 99 / 100] * 1000, sorted[n - 1] * 1000);
+}
+
+// Screens with a load phase go through loading_screen, which comes back here once the load is done.
+// The screen arena is kept across that detour, it already holds what the load made.
 void change_screen(screen_t old, screen_t new) {
     old.close();
+    if (old.name != loading_screen.name) {
+        ResetArena(&g_screenArena);
+    }
+    if (new.load != NULL && old.name != loading_screen.name) {
+        StartScreenLoad(new);
+        new = loading_screen;
+    }
     new.init();
     current_screen = new;
 }
 
 void update_screen() {
+    PROFILE_BEGIN("update_screen");
     screen_t new_screen = current_screen.update();
     if (new_screen.name != current_screen.name) {
-        printf("Change screen!\n");
+        LOGD("Change screen!");
         change_screen(current_screen, new_screen);
     }
+    PROFILE_END();
+}
+
+// Runs the ticks that fit in the time since the last frame, returns how far the frame is into the next tick
+float UpdateSimulation() {
+    const double tickTime = 1.0 / SIM_TICKS_PER_SECOND;
+
+    double now = GetTime();
+    simAccumulator += now - lastFrameTime;
+    lastFrameTime = now;
+
+    // no tick passes while a screen loads, the load takes however long the machine and the terrain cache
+    // make it and recorded input must keep its ticks
+    if (current_screen.name == loading_screen.name) {
+        update_screen();
+        simAccumulator = 0;
+        return 0.0f;
+    }
+
+    // a replay steps once per frame, so every run draws the same frames whatever the frame rate
+    if (IsInputReplaying()) {
+        simAccumulator = tickTime;
+    }
+
+    int ticks = 0;
+    while (simAccumulator >= tickTime && ticks < SIM_MAX_TICKS_PER_FRAME) {
+        StepInput();
+        if (IsInputReplayFinished()) {
+            return 1.0f;
+        }
+        update_screen();
+        simAccumulator -= tickTime;
+        ticks++;
+    }
+
+    if (simAccumulator >= tickTime) {
+        simAccumulator = fmod(simAccumulator, tickTime);
+    }
+
+    return (float)(simAccumulator / tickTime);
 }
 
 void UpdateDrawFrame() {
-    update_screen();
+    ResetArena(&g_frameArena);
+    PollInput();
+
+    bool measure = IsInputReplaying();
+    double start = measure ? GetTime() : 0;
+    float alpha = UpdateSimulation();
+    if (IsInputReplayFinished()) {
+        return;
+    }
+    if (measure) {
+        AddFrameCost(&updateCosts, GetTime() - start);
+    }
+
     float scale = fmin((float)GetScreenWidth()/SCREEN_WIDTH, (float)GetScreenHeight()/SCREEN_HEIGHT);
     BeginTextureMode(target);
-    current_screen.draw();
+    start = measure ? GetTime() : 0;
+    current_screen.draw(alpha);
+    if (measure) {
+        AddFrameCost(&drawCosts, GetTime() - start);
+    }
     EndTextureMode();
     BeginDrawing();
     ClearBackground(BLACK);     // Clear screen background
@@ -48,30 +172,92 @@ void UpdateDrawFrame() {
 
 int main(int argc, char const *argv[])
 {
+    // --record FILE saves the seed and input of the session, --replay FILE plays it back,
+    // --fast replays without the frame rate limit, --fps N caps rendering (0 for uncapped),
+    // --profile FILE writes a trace of the profiler zones on exit
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    const char* profilePath = NULL;
+    bool fast = false;
+    int fps = RENDER_FPS;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            fast = true;
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profilePath = argv[++i];
+        } else {
+            printf("Usage: %s [--fps N] [--profile FILE] [--record FILE | --replay FILE [--fast]]\n", argv[0]);
+            return 1;
+        }
+    }
+    // replays step once per frame, at the tick rate unless --fast
+    if (replayPath != NULL) {
+        fps = fast ? 0 : SIM_TICKS_PER_SECOND;
+    }
+
+    InitLog();
+    InitJobs(0);
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Window title");
 
+    unsigned int seed = (unsigned int)time(NULL);
+    if (replayPath != NULL) {
+        if (!StartInputReplay(replayPath, &seed)) {
+            CloseWindow();
+            CloseJobs();
+            CloseLog();
+            return 1;
+        }
+    } else if (recordPath != NULL) {
+        StartInputRecording(recordPath, seed);
+    }
+    SetRandomSeed(seed);
+
     target = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
     SetTextureFilter(target.texture, TEXTURE_FILTER_BILINEAR);  // Texture scale filter to use
 
     current_screen = game_over_screen;
     current_screen.init();
+    lastFrameTime = GetTime();
 
 #if defined(PLATFORM_WEB)
-    emscripten_set_main_loop(UpdateDrawFrame, 60, 1);
+    emscripten_set_main_loop(UpdateDrawFrame, 0, 1);    // browser frame rate, the simulation keeps its own
 #else
-    SetTargetFPS(30);       // Set our game to run at 60 frames-per-second
+    SetTargetFPS(fps);
     //--------------------------------------------------------------------------------------
 
     // Main game loop
-    while (!WindowShouldClose())    // Detect window close button or ESC key
+    while (!WindowShouldClose() && !IsInputReplayFinished())    // Detect window close button or ESC key
     {
         UpdateDrawFrame();
     }
 #endif
 
-    current_screen.close();
+    if (IsInputReplaying()) {
+        printf("Replayed %d frames\n", updateCosts.count);
+        PrintFrameCosts("update", &updateCosts);
+        PrintFrameCosts("draw", &drawCosts);
+    }
+    StopInput();
+    MemFree(updateCosts.samples);
+    MemFree(drawCosts.samples);
+
+    current_screen.close();        // joins the loading thread, which may still be inside a zone
+    if (profilePath != NULL) {
+        ExportProfilerTrace(profilePath);
+        PrintProfilerSummary();
+    }
+    UnloadArena(&g_screenArena);    // GPU cleanups need the window
+    UnloadArena(&g_frameArena);
     CloseWindow();
+    CloseJobs();
+    CloseLog();
 
     return 0;
 }
@@ -0,0 +1,209 @@
+#include "noise.h"
+
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "raymath.h"
+
+#include "jobs.h"
+
+#define CELL_SIZE   32.0f
+
+#define GRID_SIZE 128
+
+#define WORLEY_BAND_ROWS    32      // rows per job
+
+static Vector2 gradients[GRID_SIZE][GRID_SIZE];
+static bool gradientsSeeded;
+
+static uint32_t HashCell(int x, int y, unsigned int seed) {
+    uint32_t h = seed ^ (uint32_t)x * 0x8da6b343u ^ (uint32_t)y * 0xd8163841u;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+void SetPerlinSeed(unsigned int seed) {
+    for (int ix = 0; ix < GRID_SIZE; ix++) {
+        for (int iy = 0; iy < GRID_SIZE; iy++) {
+            float angle = HashCell(ix, iy, seed) / 4294967296.0f * PI * 2;
+            gradients[ix][iy] = (Vector2){ cosf(angle), sinf(angle) };
+        }
+    }
+    gradientsSeeded = true;
+}
+
+static Vector2 randomGradient(int ix, int iy) {
+    if (!gradientsSeeded) {
+        SetPerlinSeed(0);
+    }
+
+    // the lattice repeats every GRID_SIZE cells
+    return gradients[ix & (GRID_SIZE - 1)][iy & (GRID_SIZE - 1)];
+}
+
+// /* Create pseudorandom direction vector
+//  */
+// Vector2 randomGradient(int ix, int iy) {
+//     // No precomputed gradients mean this works for any number of grid coordinates
+//     const unsigned w = 8 * sizeof(unsigned);
+//     const unsigned s = w / 2; // rotation width
+//     unsigned a = ix, b = iy;
+//     a *= 3284157443; b ^= a << s | a >> w-s;
+//     b *= 1911520717; a ^= b << s | b >> w-s;
+//     a *= 2048419325;
+//     float random = a * (3.14159265 / ~(~0u >> 1)); // in [0, 2*Pi]
+//     Vector2 v;
+//     v.x = cosf(random); v.y = sinf(random);
+//     return v;
+// }
+
+// Computes the dot product of the distance and gradient vectors.
+static float dotGridGradient(int ix, int iy, float x, float y) {
+    // Get gradient from integer coordinates
+    Vector2 gradient = randomGradient(ix, iy);
+
+    // Compute the distance vector
+    Vector2 dist = {x - (float)ix, y - (float)iy};
+
+    return Vector2DotProduct(dist, gradient);
+}
+
+static float interpolate(float a0, float a1, float w) {
+    // cubic interpolation
+    return (a1 - a0) * (3.0 - w * 2.0) * w * w + a0;
+}
+
+// Compute Perlin noise at coordinates x, y
+float perlin(float x, float y) {
+    // Determine grid cell coordinates
+    int x0 = (int)floor(x);
+    int x1 = x0 + 1;
+    int y0 = (int)floor(y);
+    int y1 = y0 + 1;
+
+    // Determine interpolation weights
+    // Could also use higher order polynomial/s-curve here
+    float sx = x - (float)x0;
+    float sy = y - (float)y0;
+
+    // Interpolate between grid point gradients
+    float n0, n1, ix0, ix1, value;
+
+    n0 = dotGridGradient(x0, y0, x, y);
+    n1 = dotGridGradient(x1, y0, x, y);
+    ix0 = interpolate(n0, n1, sx);
+
+    n0 = dotGridGradient(x0, y1, x, y);
+    n1 = dotGridGradient(x1, y1, x, y);
+    ix1 = interpolate(n0, n1, sx);
+
+    value = interpolate(ix0, ix1, sy);
+    return (value + 1.0) / 2.0;
+}
+
+Image GenImagePerlin(int width, int height) {
+    Image image = GenImageColor(width, height, RAYWHITE);
+    for (int i = 0; i < width; i++)
+    {
+        for (int j = 0; j < height; j++)
+        {
+            // float value1 = 
+            float noise = (perlin(i / CELL_SIZE, j / CELL_SIZE)
+                + 0.5 * perlin(i / CELL_SIZE * 2, j / CELL_SIZE * 2)
+                + 0.25 * perlin(i / CELL_SIZE * 4, j / CELL_SIZE * 4))
+                    / 1.75;
+            // [0.0; 1.0] => [0; 255]
+            unsigned char value = (unsigned char)(noise * 255);
+            if (i == 0) {
+                // printf("%f -> %d\n", noise, value);
+            }
+            Color color = {value, value, value, 255};
+            ImageDrawPixel(&image, i, j, color);
+        }
+    }
+
+    return image;
+}
+
+typedef struct {
+    float* noise;
+    int width;
+    int cellSize;
+    unsigned int seed;
+} WorleyParams;
+
+// Feature point of the cell, anywhere inside it
+static Vector2 GetWorleyPoint(int x, int y, unsigned int seed, int cellSize) {
+    uint32_t h = HashCell(x, y, seed);
+    return (Vector2){ (x + (h & 0xffff) / 65536.0f) * cellSize, (y + (h >> 16) / 65536.0f) * cellSize };
+}
+
+// A point outside the 3x3 cells around a pixel is more than a cell away, where the noise is clamped anyway
+static void GenWorleyBand(int firstRow, int lastRow, void* data) {
+    const WorleyParams* params = data;
+    int cellSize = params->cellSize;
+    int rowPoints = (params->width + cellSize - 1) / cellSize + 2;
+    Vector2* points = MemAlloc(3 * rowPoints * sizeof(Vector2));    // of the cell rows around the current one
+    int pointsRow = INT_MIN;
+    float invCellSize = 1.0f / cellSize;
+
+    for (int y = firstRow; y < lastRow; y++) {
+        int cy = y / cellSize;
+        if (cy != pointsRow) {
+            for (int r = 0; r < 3; r++) {
+                for (int c = 0; c < rowPoints; c++) {
+                    points[r * rowPoints + c] = GetWorleyPoint(c - 1, cy + r - 1, params->seed, cellSize);
+                }
+            }
+            pointsRow = cy;
+        }
+
+        // the pixels of a cell share their 9 candidates
+        float* row = &params->noise[y * params->width];
+        for (int cx = 0; cx * cellSize < params->width; cx++) {
+            Vector2 candidates[9];
+            for (int r = 0; r < 3; r++) {
+                for (int c = 0; c < 3; c++) {
+                    candidates[r * 3 + c] = points[r * rowPoints + cx + c];
+                    candidates[r * 3 + c].y -= y;
+                }
+            }
+
+            int last = (cx + 1) * cellSize < params->width ? (cx + 1) * cellSize : params->width;
+            for (int x = cx * cellSize; x < last; x++) {
+                float nearest = FLT_MAX;
+                for (int p = 0; p < 9; p++) {
+                    float dx = candidates[p].x - x;
+                    float d = dx * dx + candidates[p].y * candidates[p].y;
+                    nearest = d < nearest ? d : nearest;
+                }
+                row[x] = fminf(sqrtf(nearest) * invCellSize, 1.0f);
+            }
+        }
+    }
+
+    MemFree(points);
+}
+
+void GenWorleyNoise(float* noise, int width, int height, int cellSize, unsigned int seed) {
+    WorleyParams params = { noise, width, cellSize, seed };
+    ParallelFor(0, height, WORLEY_BAND_ROWS, GenWorleyBand, &params);
+}
+
+Image GenImageWorley(int width, int height, int cellSize, unsigned int seed) {
+    float* noise = MemAlloc(width * height * sizeof(float));
+    GenWorleyNoise(noise, width, height, cellSize, seed);
+    return (Image){
+        .data = noise,
+        .width = width,
+        .height = height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R32
+    };
+}
@@ -0,0 +1,23 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+#include "raylib.h"
+
+// Compute Perlin noise at coordinates x, y, result is in [0.0; 1.0]
+float perlin(float x, float y);
+// Refills the gradient lattice from a hash of the seed, so the same seed always gives the same noise. Seed 0
+// until called. Not while perlin() runs on another thread.
+void SetPerlinSeed(unsigned int seed);
+
+// Three octaves of perlin(), 32 pixels per lattice cell
+Image GenImagePerlin(int width, int height);
+
+// Worley (cellular) noise: distance from every pixel to the nearest feature point, one per square cell of
+// cellSize pixels, in cells and clamped to [0.0; 1.0]. The points are hashed from the cell and the seed, so
+// the same seed always gives the same noise. Row bands are generated on the job pool.
+void GenWorleyNoise(float* noise, int width, int height, int cellSize, unsigned int seed);
+
+// GenWorleyNoise() in a PIXELFORMAT_UNCOMPRESSED_R32 image
+Image GenImageWorley(int width, int height, int cellSize, unsigned int seed);
+
+#endif /* NOISE_H */
@@ -7,119 +7,26 @@
 
 #include "collisions.h"
 #include "const.h"
+#include "jobs.h"
+#include "noise.h"
 
 #define W   SCREEN_WIDTH - 40
 #define H   SCREEN_HEIGHT - 60
-#define CELL_SIZE   32.0f
 
-#define GRID_SIZE 128
+#define WATER_LINES_GRAIN   1024    // triangles per job
 
 typedef struct {
-    bool occupied;
-    Vector2 coords;
-} GradientCell;
-
-GradientCell gradients[GRID_SIZE][GRID_SIZE];
-
-Vector2 randomGradient(int ix, int iy) {
-    if (!gradients[ix][iy].occupied) {
-        float angle = Remap(GetRandomValue(0, 1000), 0, 1000, 0.0, PI * 2);
-        gradients[ix][iy].coords.x = cosf(angle);
-        gradients[ix][iy].coords.y = sinf(angle);
-        gradients[ix][iy].occupied = true;
-    }
-
-    return gradients[ix][iy].coords;
-}
-
-// /* Create pseudorandom direction vector
-//  */
-// Vector2 randomGradient(int ix, int iy) {
-//     // No precomputed gradients mean this works for any number of grid coordinates
-//     const unsigned w = 8 * sizeof(unsigned);
-//     const unsigned s = w / 2; // rotation width
-//     unsigned a = ix, b = iy;
-//     a *= 3284157443; b ^= a << s | a >> w-s;
-//     b *= 1911520717; a ^= b << s | b >> w-s;
-//     a *= 2048419325;
-//     float random = a * (3.14159265 / ~(~0u >> 1)); // in [0, 2*Pi]
-//     Vector2 v;
-//     v.x = cosf(random); v.y = sinf(random);
-//     return v;
-// }
-
-// Computes the dot product of the distance and gradient vectors.
-float dotGridGradient(int ix, int iy, float x, float y) {
-    // Get gradient from integer coordinates
-    Vector2 gradient = randomGradient(ix, iy);
-
-    // Compute the distance vector
-    Vector2 dist = {x - (float)ix, y - (float)iy};
-
-    return Vector2DotProduct(dist, gradient);
-}
-
-float interpolate(float a0, float a1, float w) {
-    // cubic interpolation
-    return (a1 - a0) * (3.0 - w * 2.0) * w * w + a0;
-}
-
-// Compute Perlin noise at coordinates x, y
-float perlin(float x, float y) {
-    // Determine grid cell coordinates
-    int x0 = (int)floor(x);
-    int x1 = x0 + 1;
-    int y0 = (int)floor(y);
-    int y1 = y0 + 1;
+    Mesh mesh;
+    Plane plane;
+    Line3d* lines;      // per triangle
+    bool* hits;
+} WaterLines;
 
-    // Determine interpolation weights
-    // Could also use higher order polynomial/s-curve here
-    float sx = x - (float)x0;
-    float sy = y - (float)y0;
+void FindWaterLines(int first, int last, void* data) {
+    WaterLines* water = data;
+    Mesh mesh = water->mesh;
 
-    // Interpolate between grid point gradients
-    float n0, n1, ix0, ix1, value;
-
-    n0 = dotGridGradient(x0, y0, x, y);
-    n1 = dotGridGradient(x1, y0, x, y);
-    ix0 = interpolate(n0, n1, sx);
-
-    n0 = dotGridGradient(x0, y1, x, y);
-    n1 = dotGridGradient(x1, y1, x, y);
-    ix1 = interpolate(n0, n1, sx);
-
-    value = interpolate(ix0, ix1, sy);
-    return (value + 1.0) / 2.0;
-}
-
-Image GenImagePerlin(int width, int height) {
-    Image image = GenImageColor(width, height, RAYWHITE);
-    for (int i = 0; i < width; i++)
-    {
-        for (int j = 0; j < height; j++)
-        {
-            // float value1 = 
-            float noise = (perlin(i / CELL_SIZE, j / CELL_SIZE)
-                + 0.5 * perlin(i / CELL_SIZE * 2, j / CELL_SIZE * 2)
-                + 0.25 * perlin(i / CELL_SIZE * 4, j / CELL_SIZE * 4))
-                    / 1.75;
-            // [0.0; 1.0] => [0; 255]
-            unsigned char value = (unsigned char)(noise * 255);
-            if (i == 0) {
-                // printf("%f -> %d\n", noise, value);
-            }
-            Color color = {value, value, value, 255};
-            ImageDrawPixel(&image, i, j, color);
-        }
-    }
-
-    return image;
-}
-
-void DrawWaterLines(Mesh mesh, float waterLevel) {
-    Plane waterPlane = {(Vector3){0, 1, 0}, waterLevel};
-
-    for (int i = 0; i < mesh.triangleCount; i++) {
+    for (int i = first; i < last; i++) {
         Vector3 a, b, c;
         Vector3* vertdata = (Vector3*)mesh.vertices;
 
@@ -137,14 +44,28 @@ void DrawWaterLines(Mesh mesh, float waterLevel) {
         }
 
         Triangle test = {a, b, c};
-        Line3d out = {0};
-
-        // printf("Check [%.2f;%.2f;%.2f][%.2f;%.2f;%.2f][%.2f;%.2f;%.2f] vs %.2f\n", a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z, waterLevel);
-        if (CheckCollisionTrianglePlane(test, waterPlane, &out)) {
-            // printf("true: [%.2f;%.2f;%.2f][%.2f;%.2f;%.2f]\n", out.p1.x, out.p1.y, out.p1.z, out.p2.x, out.p2.y, out.p2.z);
-            DrawLine3D(out.p1, out.p2, BLUE);
-        } else {
-            // printf("false\n");
+        water->lines[i] = (Line3d){0};
+        water->hits[i] = CheckCollisionTrianglePlane(test, water->plane, &water->lines[i]);
+    }
+}
+
+// The triangles are tested on the job pool, only drawing stays on the main thread
+void DrawWaterLines(Mesh mesh, float waterLevel) {
+    static WaterLines water;
+    static int allocated;
+    if (allocated < mesh.triangleCount) {
+        allocated = mesh.triangleCount;
+        water.lines = MemRealloc(water.lines, sizeof(Line3d) * allocated);
+        water.hits = MemRealloc(water.hits, sizeof(bool) * allocated);
+    }
+    water.mesh = mesh;
+    water.plane = (Plane){(Vector3){0, 1, 0}, waterLevel};
+
+    ParallelFor(0, mesh.triangleCount, WATER_LINES_GRAIN, FindWaterLines, &water);
+
+    for (int i = 0; i < mesh.triangleCount; i++) {
+        if (water.hits[i]) {
+            DrawLine3D(water.lines[i].p1, water.lines[i].p2, BLUE);
         }
     }
 }
@@ -152,6 +73,7 @@ void DrawWaterLines(Mesh mesh, float waterLevel) {
 int main(int argc, char const *argv[])
 {
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Window title");
+    InitJobs(0);
     SetTargetFPS(60);
 
     // Define our custom camera to look into our 3d world
@@ -219,6 +141,7 @@ int main(int argc, char const *argv[])
     UnloadModel(model);         // Unload model
 
     CloseWindow();              // Close window and OpenGL context
+    CloseJobs();
     //--------------------------------------------------------------------------------------
 
     return 0;
@@ -0,0 +1,26 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdint.h>
+#include <time.h>
+
+// What the compilers and platforms disagree on, for the modules that need more than raylib gives
+
+#if defined(_MSC_VER)
+    #define THREAD_LOCAL __declspec(thread)
+#else
+    #define THREAD_LOCAL _Thread_local
+#endif
+
+// Monotonic clock in ns, for timing on any thread. GetTime() needs the window and only has raylib's precision.
+static inline uint64_t GetClockNs() {
+    struct timespec ts;
+#if defined(_WIN32)
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#endif /* PLATFORM_H */
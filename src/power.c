@@ -0,0 +1,234 @@
+#include "power.h"
+
+#include <string.h>
+
+#define POWER_MIN_SLOTS     64      // first allocation of a bucket, and the least slots worth compacting
+
+static void AddToTree(PowerBucket* bucket, int slot, int delta) {
+    for (int i = slot + 1; i <= bucket->allocated; i += i & -i) {
+        bucket->tree[i] += delta;
+    }
+}
+
+static void BuildTree(PowerBucket* bucket) {
+    memset(bucket->tree, 0, sizeof(int) * (bucket->allocated + 1));
+    for (int i = 1; i <= bucket->allocated; i++) {
+        if (i <= bucket->count) {
+            bucket->tree[i] += bucket->consumption[i - 1];
+        }
+        int parent = i + (i & -i);
+        if (parent <= bucket->allocated) {
+            bucket->tree[parent] += bucket->tree[i];
+        }
+    }
+}
+
+// Slots from the front of the bucket the budget affords, and their consumption
+static int FindPowerCut(const PowerBucket* bucket, int budget, int* used) {
+    int slot = 0;
+    int sum = 0;
+    for (int step = bucket->allocated; step > 0; step >>= 1) {
+        if (slot + step <= bucket->allocated && sum + bucket->tree[slot + step] <= budget) {
+            slot += step;
+            sum += bucket->tree[slot];
+        }
+    }
+
+    *used = sum;
+    return slot < bucket->count ? slot : bucket->count;
+}
+
+static bool IsBeforeCut(int bucket, int slot, int cutBucket, int cutSlot) {
+    return bucket < cutBucket || (bucket == cutBucket && slot < cutSlot);
+}
+
+static void ReserveIds(PowerDispatch* dispatch, BuildingId id) {
+    if (id < dispatch->idAllocated) {
+        return;
+    }
+
+    int allocated = dispatch->idAllocated == 0 ? POWER_MIN_SLOTS : dispatch->idAllocated;
+    while (allocated <= id) {
+        allocated *= 2;
+    }
+    dispatch->slotOf = MemRealloc(dispatch->slotOf, sizeof(int) * allocated);
+    dispatch->bucketOf = MemRealloc(dispatch->bucketOf, allocated);
+    memset(&dispatch->slotOf[dispatch->idAllocated], -1, sizeof(int) * (allocated - dispatch->idAllocated));
+    dispatch->idAllocated = allocated;
+}
+
+static void ReserveSlot(PowerBucket* bucket) {
+    if (bucket->count < bucket->allocated) {
+        return;
+    }
+
+    bucket->allocated = bucket->allocated == 0 ? POWER_MIN_SLOTS : bucket->allocated * 2;
+    bucket->id = MemRealloc(bucket->id, sizeof(BuildingId) * bucket->allocated);
+    bucket->consumption = MemRealloc(bucket->consumption, sizeof(int) * bucket->allocated);
+    bucket->tree = MemRealloc(bucket->tree, sizeof(int) * (bucket->allocated + 1));
+    BuildTree(bucket);
+}
+
+// Drops the holes, keeps the order and so the powered consumers
+static void CompactBucket(PowerDispatch* dispatch, int b) {
+    PowerBucket* bucket = &dispatch->buckets[b];
+    int count = 0;
+    int cutSlot = dispatch->cutSlot;
+    for (int s = 0; s < bucket->count; s++) {
+        if (dispatch->cutBucket == b && s == dispatch->cutSlot) {
+            cutSlot = count;
+        }
+        if (bucket->id[s] < 0) {
+            continue;
+        }
+
+        bucket->id[count] = bucket->id[s];
+        bucket->consumption[count] = bucket->consumption[s];
+        dispatch->slotOf[bucket->id[count]] = count;
+        count++;
+    }
+
+    if (dispatch->cutBucket == b) {
+        dispatch->cutSlot = dispatch->cutSlot >= bucket->count ? count : cutSlot;
+    }
+    bucket->count = count;
+    BuildTree(bucket);
+}
+
+void InitPowerDispatch(PowerDispatch* dispatch, PowerCallback onChange, void* user) {
+    for (int b = 0; b < POWER_PRIORITIES; b++) {
+        PowerBucket* bucket = &dispatch->buckets[b];
+        bucket->count = 0;
+        bucket->live = 0;
+        bucket->total = 0;
+        if (bucket->tree != NULL) {
+            memset(bucket->tree, 0, sizeof(int) * (bucket->allocated + 1));
+        }
+    }
+    if (dispatch->slotOf != NULL) {
+        memset(dispatch->slotOf, -1, sizeof(int) * dispatch->idAllocated);
+    }
+
+    dispatch->cutBucket = 0;
+    dispatch->cutSlot = 0;
+    dispatch->capacity = 0;
+    dispatch->used = 0;
+    dispatch->dirty = false;
+    dispatch->addedCount = 0;
+    dispatch->onChange = onChange;
+    dispatch->user = user;
+}
+
+void UnloadPowerDispatch(PowerDispatch* dispatch) {
+    for (int b = 0; b < POWER_PRIORITIES; b++) {
+        MemFree(dispatch->buckets[b].id);
+        MemFree(dispatch->buckets[b].consumption);
+        MemFree(dispatch->buckets[b].tree);
+    }
+    MemFree(dispatch->slotOf);
+    MemFree(dispatch->bucketOf);
+    MemFree(dispatch->added);
+    *dispatch = (PowerDispatch){0};
+}
+
+void AddPowerConsumer(PowerDispatch* dispatch, BuildingId id, int consumption, int priority) {
+    if (consumption <= 0) {
+        dispatch->onChange(id, true, dispatch->user);
+        return;
+    }
+
+    int b = priority < 0 ? 0 : priority >= POWER_PRIORITIES ? POWER_PRIORITIES - 1 : priority;
+    PowerBucket* bucket = &dispatch->buckets[b];
+    ReserveSlot(bucket);
+    ReserveIds(dispatch, id);
+
+    int slot = bucket->count++;
+    bucket->id[slot] = id;
+    bucket->consumption[slot] = consumption;
+    bucket->live++;
+    bucket->total += consumption;
+    AddToTree(bucket, slot, consumption);
+    dispatch->slotOf[id] = slot;
+    dispatch->bucketOf[id] = b;
+
+    if (dispatch->addedCount == dispatch->addedAllocated) {
+        dispatch->addedAllocated = dispatch->addedAllocated == 0 ? 16 : dispatch->addedAllocated * 2;
+        dispatch->added = MemRealloc(dispatch->added, sizeof(BuildingId) * dispatch->addedAllocated);
+    }
+    dispatch->added[dispatch->addedCount++] = id;
+    dispatch->dirty = true;
+}
+
+void RemovePowerConsumer(PowerDispatch* dispatch, BuildingId id) {
+    if (id < 0 || id >= dispatch->idAllocated || dispatch->slotOf[id] < 0) {
+        return;
+    }
+
+    int b = dispatch->bucketOf[id];
+    int slot = dispatch->slotOf[id];
+    PowerBucket* bucket = &dispatch->buckets[b];
+    AddToTree(bucket, slot, -bucket->consumption[slot]);
+    bucket->total -= bucket->consumption[slot];
+    bucket->consumption[slot] = 0;
+    bucket->id[slot] = -1;
+    bucket->live--;
+    dispatch->slotOf[id] = -1;
+    dispatch->dirty = true;
+
+    if (bucket->count >= POWER_MIN_SLOTS && bucket->live * 2 < bucket->count) {
+        CompactBucket(dispatch, b);
+    }
+}
+
+// Fires onChange for every consumer in [from; to)
+static void SetPowerRange(PowerDispatch* dispatch, int fromBucket, int fromSlot, int toBucket, int toSlot, bool powered) {
+    for (int b = fromBucket; b <= toBucket && b < POWER_PRIORITIES; b++) {
+        const PowerBucket* bucket = &dispatch->buckets[b];
+        int first = b == fromBucket ? fromSlot : 0;
+        int last = b == toBucket ? toSlot : bucket->count;
+        for (int s = first; s < last && s < bucket->count; s++) {
+            if (bucket->id[s] >= 0) {
+                dispatch->onChange(bucket->id[s], powered, dispatch->user);
+            }
+        }
+    }
+}
+
+void DispatchPower(PowerDispatch* dispatch, int capacity) {
+    if (!dispatch->dirty && capacity == dispatch->capacity) {
+        return;
+    }
+
+    // whole buckets first, the first one the supply cannot afford is cut inside
+    int budget = capacity;
+    int b = 0;
+    while (b < POWER_PRIORITIES && dispatch->buckets[b].total <= budget) {
+        budget -= dispatch->buckets[b].total;
+        b++;
+    }
+    int slot = 0;
+    int partial = 0;
+    if (b < POWER_PRIORITIES) {
+        slot = FindPowerCut(&dispatch->buckets[b], budget, &partial);
+    }
+
+    if (IsBeforeCut(dispatch->cutBucket, dispatch->cutSlot, b, slot)) {
+        SetPowerRange(dispatch, dispatch->cutBucket, dispatch->cutSlot, b, slot, true);
+    } else {
+        SetPowerRange(dispatch, b, slot, dispatch->cutBucket, dispatch->cutSlot, false);
+    }
+    dispatch->cutBucket = b;
+    dispatch->cutSlot = slot;
+
+    for (int i = 0; i < dispatch->addedCount; i++) {
+        BuildingId id = dispatch->added[i];
+        if (dispatch->slotOf[id] >= 0) {
+            dispatch->onChange(id, IsBeforeCut(dispatch->bucketOf[id], dispatch->slotOf[id], b, slot), dispatch->user);
+        }
+    }
+    dispatch->addedCount = 0;
+
+    dispatch->capacity = capacity;
+    dispatch->used = capacity - budget + partial;
+    dispatch->dirty = false;
+}
@@ -0,0 +1,59 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "raylib.h"
+
+#include "buildings.h"
+
+#define POWER_PRIORITIES    4       // 0 is served first
+
+typedef void (*PowerCallback)(BuildingId id, bool powered, void* user);
+
+// Consumers of one priority in the order they were added. Removal leaves a hole of no consumption, the slots
+// are compacted once holes outnumber consumers.
+typedef struct {
+    BuildingId* id;         // per slot, -1 for holes
+    int* consumption;       // per slot
+    int* tree;              // Fenwick tree over consumption, 1-based, allocated + 1 entries
+    int count;              // slots used, holes included
+    int live;
+    int allocated;          // power of two
+    int total;              // sum of consumption
+} PowerBucket;
+
+// Consumers are ordered by priority, then by age. The supply powers the longest run of them it can afford
+// from the front of that order, the rest are browned out. Dispatching again only touches the consumers
+// between the old and the new end of the run plus the ones added since, and costs nothing if neither the
+// supply nor the demand changed.
+typedef struct {
+    PowerBucket buckets[POWER_PRIORITIES];
+    int* slotOf;            // id -> slot in its bucket, -1 if not tracked
+    unsigned char* bucketOf;
+    int idAllocated;
+
+    int cutBucket;          // consumers before slot cutSlot of bucket cutBucket are powered
+    int cutSlot;
+    int capacity;           // of the last dispatch
+    int used;
+    bool dirty;             // demand changed since the last dispatch
+
+    BuildingId* added;      // since the last dispatch
+    int addedCount;
+    int addedAllocated;
+
+    PowerCallback onChange; // fired for every consumer whose state may have changed
+    void* user;
+} PowerDispatch;
+
+// Also forgets every consumer, keeps the memory
+void InitPowerDispatch(PowerDispatch* dispatch, PowerCallback onChange, void* user);
+void UnloadPowerDispatch(PowerDispatch* dispatch);
+
+// Priority is clamped to [0; POWER_PRIORITIES). Consumers of no power are powered right away and not tracked.
+void AddPowerConsumer(PowerDispatch* dispatch, BuildingId id, int consumption, int priority);
+void RemovePowerConsumer(PowerDispatch* dispatch, BuildingId id);
+
+// O(log n) plus one callback per consumer that may have changed state
+void DispatchPower(PowerDispatch* dispatch, int capacity);
+
+#endif /* POWER_H */
@@ -0,0 +1,233 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "raylib.h"
+
+#include "platform.h"
+#include "profiler.h"
+
+#if PROFILER_ENABLED
+
+typedef struct {
+    const char* name;
+    uint64_t start;     // ns
+    uint64_t duration;  // ns
+    int depth;
+} ProfileZone;
+
+typedef struct {
+    int id;
+    atomic_bool inUse;      // false once its thread exited, the next new thread takes it over
+    ProfileZone* zones;     // ring of PROFILER_RING_SIZE
+    uint64_t written;       // zones recorded so far, the ring holds the last PROFILER_RING_SIZE of them
+    const char* openNames[PROFILER_MAX_DEPTH];
+    uint64_t openStarts[PROFILER_MAX_DEPTH];
+    int depth;
+} ProfileThread;
+
+typedef struct {
+    const char* name;
+    int count;
+    uint64_t total;
+    uint64_t max;
+} ProfileSummary;
+
+static ProfileThread* _Atomic threads[PROFILER_MAX_THREADS];
+static atomic_int threadCount;
+static THREAD_LOCAL ProfileThread* currentThread;
+static THREAD_LOCAL bool noProfileThread;   // every slot was taken when this thread asked
+
+static ProfileThread* GetProfileThread() {
+    if (currentThread != NULL || noProfileThread) {
+        return currentThread;
+    }
+
+    // slots of exited threads first, their ring keeps going
+    int count = atomic_load(&threadCount);
+    for (int t = 0; t < count && t < PROFILER_MAX_THREADS; t++) {
+        ProfileThread* thread = atomic_load(&threads[t]);
+        bool released = false;
+        if (thread != NULL && atomic_compare_exchange_strong(&thread->inUse, &released, true)) {
+            currentThread = thread;
+            return thread;
+        }
+    }
+
+    int id = atomic_load(&threadCount);
+    do {
+        if (id >= PROFILER_MAX_THREADS) {
+            noProfileThread = true;
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak(&threadCount, &id, id + 1));
+
+    ProfileThread* thread = MemAlloc(sizeof(ProfileThread));
+    thread->id = id;
+    atomic_init(&thread->inUse, true);
+    thread->zones = MemAlloc(sizeof(ProfileZone) * PROFILER_RING_SIZE);
+    atomic_store(&threads[id], thread);
+    currentThread = thread;
+    return thread;
+}
+
+void ProfileThreadExit() {
+    ProfileThread* thread = currentThread;
+    if (thread == NULL) {
+        return;
+    }
+
+    thread->depth = 0;
+    currentThread = NULL;
+    atomic_store(&thread->inUse, false);
+}
+
+void ProfileBegin(const char* name) {
+    ProfileThread* thread = GetProfileThread();
+    if (thread == NULL) {
+        return;
+    }
+
+    // zones nested deeper than the stack are counted but not recorded
+    if (thread->depth < PROFILER_MAX_DEPTH) {
+        thread->openNames[thread->depth] = name;
+        thread->openStarts[thread->depth] = GetClockNs();
+    }
+    thread->depth++;
+}
+
+void ProfileEnd() {
+    ProfileThread* thread = currentThread;
+    if (thread == NULL || thread->depth == 0) {
+        return;
+    }
+
+    int depth = --thread->depth;
+    if (depth >= PROFILER_MAX_DEPTH) {
+        return;
+    }
+
+    ProfileZone* zone = &thread->zones[thread->written & (PROFILER_RING_SIZE - 1)];
+    zone->name = thread->openNames[depth];
+    zone->start = thread->openStarts[depth];
+    zone->duration = GetClockNs() - zone->start;
+    zone->depth = depth;
+    thread->written++;
+}
+
+// Calls visit for every zone still in the rings, oldest first per thread
+static void ForEachZone(void (*visit)(const ProfileThread* thread, const ProfileZone* zone, void* user), void* user) {
+    int count = atomic_load(&threadCount);
+    if (count > PROFILER_MAX_THREADS) {
+        count = PROFILER_MAX_THREADS;
+    }
+
+    for (int t = 0; t < count; t++) {
+        ProfileThread* thread = atomic_load(&threads[t]);
+        if (thread == NULL) {
+            continue;
+        }
+
+        uint64_t first = thread->written > PROFILER_RING_SIZE ? thread->written - PROFILER_RING_SIZE : 0;
+        for (uint64_t i = first; i < thread->written; i++) {
+            visit(thread, &thread->zones[i & (PROFILER_RING_SIZE - 1)], user);
+        }
+    }
+}
+
+typedef struct {
+    FILE* file;
+    bool first;
+    uint64_t origin;
+} TraceWriter;
+
+static void FindOrigin(const ProfileThread* thread, const ProfileZone* zone, void* user) {
+    uint64_t* origin = user;
+    if (zone->start < *origin) {
+        *origin = zone->start;
+    }
+}
+
+static void WriteTraceZone(const ProfileThread* thread, const ProfileZone* zone, void* user) {
+    TraceWriter* writer = user;
+    fprintf(writer->file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+        writer->first ? "" : ",", zone->name, thread->id,
+        (zone->start - writer->origin) / 1000.0, zone->duration / 1000.0);
+    writer->first = false;
+}
+
+bool ExportProfilerTrace(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        printf("Unable to write profiler trace to %s\n", path);
+        return false;
+    }
+
+    TraceWriter writer = { file, true, UINT64_MAX };
+    ForEachZone(FindOrigin, &writer.origin);
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    ForEachZone(WriteTraceZone, &writer);
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    printf("Profiler trace written to %s\n", path);
+    return true;
+}
+
+#define SUMMARY_SLOTS 256   // distinct zone names, power of two
+
+static void AddToSummary(const ProfileThread* thread, const ProfileZone* zone, void* user) {
+    ProfileSummary* summary = user;
+    uintptr_t slot = ((uintptr_t)zone->name >> 3) & (SUMMARY_SLOTS - 1);
+    for (int probe = 0; probe < SUMMARY_SLOTS; probe++, slot = (slot + 1) & (SUMMARY_SLOTS - 1)) {
+        ProfileSummary* entry = &summary[slot];
+        if (entry->name == NULL) {
+            entry->name = zone->name;
+        }
+        if (entry->name == zone->name) {
+            entry->count++;
+            entry->total += zone->duration;
+            if (zone->duration > entry->max) {
+                entry->max = zone->duration;
+            }
+            return;
+        }
+    }
+}
+
+// Most expensive first, unused slots last
+static int CompareSummaries(const void* a, const void* b) {
+    const ProfileSummary* x = a;
+    const ProfileSummary* y = b;
+    if ((x->name == NULL) != (y->name == NULL)) {
+        return x->name == NULL ? 1 : -1;
+    }
+    return (x->total < y->total) - (x->total > y->total);
+}
+
+void PrintProfilerSummary() {
+    ProfileSummary* summary = MemAlloc(sizeof(ProfileSummary) * SUMMARY_SLOTS);
+    ForEachZone(AddToSummary, summary);
+    qsort(summary, SUMMARY_SLOTS, sizeof(ProfileSummary), CompareSummaries);
+
+    printf("%-32s %10s %12s %10s %10s\n", "zone", "count", "total ms", "avg us", "max us");
+    for (int i = 0; i < SUMMARY_SLOTS && summary[i].name != NULL; i++) {
+        ProfileSummary entry = summary[i];
+        printf("%-32s %10d %12.3f %10.3f %10.3f\n", entry.name, entry.count,
+            entry.total / 1e6, entry.total / 1e3 / entry.count, entry.max / 1e3);
+    }
+
+    MemFree(summary);
+}
+
+#else
+
+void ProfileBegin(const char* name) {}
+void ProfileEnd() {}
+void ProfileThreadExit() {}
+bool ExportProfilerTrace(const char* path) { return false; }
+void PrintProfilerSummary() {}
+
+#endif /* PROFILER_ENABLED */
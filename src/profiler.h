@@ -0,0 +1,41 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+// Scoped timing zones. On in debug builds, in release builds only with -DATLANTIS_PROFILER=ON.
+//
+//   PROFILE_BEGIN("UpdateWater");
+//   ...
+//   PROFILE_END();
+//
+// Names must be string literals, zones are matched by pointer. Every thread records into its own ring buffer,
+// the oldest zones are overwritten once it is full.
+
+#if !defined(PROFILER_ENABLED) && !defined(NDEBUG)
+    #define PROFILER_ENABLED 1
+#endif
+
+#define PROFILER_RING_SIZE      (1 << 16)   // zones kept per thread, power of two
+#define PROFILER_MAX_THREADS    32
+#define PROFILER_MAX_DEPTH      64
+
+#if PROFILER_ENABLED
+    #define PROFILE_BEGIN(name) ProfileBegin(name)
+    #define PROFILE_END()       ProfileEnd()
+#else
+    #define PROFILE_BEGIN(name) ((void)0)
+    #define PROFILE_END()       ((void)0)
+#endif
+
+void ProfileBegin(const char* name);
+void ProfileEnd();
+// Call before a thread that opened zones exits. Its zones stay in the trace, its slot goes to the next new
+// thread. Threads past PROFILER_MAX_THREADS live ones are not profiled.
+void ProfileThreadExit();
+
+// Call while no other thread is inside a zone. Both are empty when the profiler is compiled out.
+bool ExportProfilerTrace(const char* path);     // Chrome trace JSON, open in chrome://tracing or ui.perfetto.dev
+void PrintProfilerSummary();                    // count, total, average and max per zone
+
+#endif /* PROFILER_H */
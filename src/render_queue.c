@@ -0,0 +1,203 @@
+#include <stdlib.h>
+
+#include "raylib.h"
+#include "rlgl.h"
+
+#include "render_queue.h"
+
+static int GetRenderMode(RenderKind kind) {
+    switch (kind) {
+        case RENDER_LINE:
+        case RENDER_RECTANGLE_LINES:
+            return RL_LINES;
+        default:
+            return RL_TRIANGLES;
+    }
+}
+
+static int GetRenderVertexCount(RenderKind kind) {
+    switch (kind) {
+        case RENDER_LINE: return 2;
+        case RENDER_RECTANGLE_LINES: return 8;
+        case RENDER_RECTANGLE: return 6;
+        case RENDER_CUBE: return 36;
+    }
+
+    return 0;
+}
+
+static RenderCommand* PushRenderCommand(RenderQueue* queue, int layer, RenderKind kind, Color color) {
+    if (queue->count == queue->allocated) {
+        queue->allocated = queue->allocated == 0 ? 256 : queue->allocated * 2;
+        queue->commands = MemRealloc(queue->commands, sizeof(RenderCommand) * queue->allocated);
+    }
+
+    RenderCommand* command = &queue->commands[queue->count];
+    command->key = ((uint32_t)layer << 16) | (uint32_t)GetRenderMode(kind);
+    command->order = queue->count++;
+    command->kind = kind;
+    command->color = color;
+    return command;
+}
+
+void PushRenderLine(RenderQueue* queue, int layer, Vector2 start, Vector2 end, Color color) {
+    RenderCommand* command = PushRenderCommand(queue, layer, RENDER_LINE, color);
+    command->line.start = start;
+    command->line.end = end;
+}
+
+void PushRenderRectangleLines(RenderQueue* queue, int layer, Rectangle rect, Color color) {
+    PushRenderCommand(queue, layer, RENDER_RECTANGLE_LINES, color)->rect = rect;
+}
+
+void PushRenderRectangle(RenderQueue* queue, int layer, Rectangle rect, Color color) {
+    PushRenderCommand(queue, layer, RENDER_RECTANGLE, color)->rect = rect;
+}
+
+void PushRenderCube(RenderQueue* queue, int layer, Vector3 position, Vector3 size, Color color) {
+    RenderCommand* command = PushRenderCommand(queue, layer, RENDER_CUBE, color);
+    command->cube.position = position;
+    command->cube.size = size;
+}
+
+static int CompareRenderCommands(const void* a, const void* b) {
+    const RenderCommand* x = a;
+    const RenderCommand* y = b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return (x->order > y->order) - (x->order < y->order);
+}
+
+// Same vertices as the raylib function of the same primitive, so nothing changes on screen
+static void EmitRenderCommand(const RenderCommand* command) {
+    Color c = command->color;
+    rlColor4ub(c.r, c.g, c.b, c.a);
+
+    switch (command->kind) {
+        case RENDER_LINE: {
+            rlVertex2f(command->line.start.x, command->line.start.y);
+            rlVertex2f(command->line.end.x, command->line.end.y);
+        } break;
+        case RENDER_RECTANGLE_LINES: {
+            // DrawRectangleLines() takes integers
+            float x = (int)command->rect.x;
+            float y = (int)command->rect.y;
+            float w = (int)command->rect.width;
+            float h = (int)command->rect.height;
+            rlVertex2f(x + 1, y + 1);
+            rlVertex2f(x + w, y + 1);
+            rlVertex2f(x + w, y + 1);
+            rlVertex2f(x + w, y + h);
+            rlVertex2f(x + w, y + h);
+            rlVertex2f(x + 1, y + h);
+            rlVertex2f(x + 1, y + h);
+            rlVertex2f(x + 1, y + 1);
+        } break;
+        case RENDER_RECTANGLE: {
+            Rectangle r = command->rect;
+            rlVertex2f(r.x, r.y);
+            rlVertex2f(r.x, r.y + r.height);
+            rlVertex2f(r.x + r.width, r.y);
+            rlVertex2f(r.x + r.width, r.y);
+            rlVertex2f(r.x, r.y + r.height);
+            rlVertex2f(r.x + r.width, r.y + r.height);
+        } break;
+        case RENDER_CUBE: {
+            Vector3 p = command->cube.position;
+            float w = command->cube.size.x / 2;
+            float h = command->cube.size.y / 2;
+            float l = command->cube.size.z / 2;
+            // front
+            rlVertex3f(p.x - w, p.y - h, p.z + l);
+            rlVertex3f(p.x + w, p.y - h, p.z + l);
+            rlVertex3f(p.x - w, p.y + h, p.z + l);
+            rlVertex3f(p.x + w, p.y + h, p.z + l);
+            rlVertex3f(p.x - w, p.y + h, p.z + l);
+            rlVertex3f(p.x + w, p.y - h, p.z + l);
+            // back
+            rlVertex3f(p.x - w, p.y - h, p.z - l);
+            rlVertex3f(p.x - w, p.y + h, p.z - l);
+            rlVertex3f(p.x + w, p.y - h, p.z - l);
+            rlVertex3f(p.x + w, p.y + h, p.z - l);
+            rlVertex3f(p.x + w, p.y - h, p.z - l);
+            rlVertex3f(p.x - w, p.y + h, p.z - l);
+            // top
+            rlVertex3f(p.x - w, p.y + h, p.z - l);
+            rlVertex3f(p.x - w, p.y + h, p.z + l);
+            rlVertex3f(p.x + w, p.y + h, p.z + l);
+            rlVertex3f(p.x + w, p.y + h, p.z - l);
+            rlVertex3f(p.x - w, p.y + h, p.z - l);
+            rlVertex3f(p.x + w, p.y + h, p.z + l);
+            // bottom
+            rlVertex3f(p.x - w, p.y - h, p.z - l);
+            rlVertex3f(p.x + w, p.y - h, p.z + l);
+            rlVertex3f(p.x - w, p.y - h, p.z + l);
+            rlVertex3f(p.x + w, p.y - h, p.z - l);
+            rlVertex3f(p.x + w, p.y - h, p.z + l);
+            rlVertex3f(p.x - w, p.y - h, p.z - l);
+            // right
+            rlVertex3f(p.x + w, p.y - h, p.z - l);
+            rlVertex3f(p.x + w, p.y + h, p.z - l);
+            rlVertex3f(p.x + w, p.y + h, p.z + l);
+            rlVertex3f(p.x + w, p.y - h, p.z + l);
+            rlVertex3f(p.x + w, p.y - h, p.z - l);
+            rlVertex3f(p.x + w, p.y + h, p.z + l);
+            // left
+            rlVertex3f(p.x - w, p.y - h, p.z - l);
+            rlVertex3f(p.x - w, p.y + h, p.z + l);
+            rlVertex3f(p.x - w, p.y + h, p.z - l);
+            rlVertex3f(p.x - w, p.y - h, p.z + l);
+            rlVertex3f(p.x - w, p.y + h, p.z + l);
+            rlVertex3f(p.x - w, p.y - h, p.z - l);
+        } break;
+    }
+}
+
+void FlushRenderQueue(RenderQueue* queue) {
+    RenderQueueStats stats = { .commands = queue->count };
+
+    int mode = -1;
+    for (int i = 0; i < queue->count; i++) {
+        int commandMode = GetRenderMode(queue->commands[i].kind);
+        if (commandMode != mode) {
+            stats.immediateBatches++;
+            mode = commandMode;
+        }
+    }
+
+    qsort(queue->commands, queue->count, sizeof(RenderCommand), CompareRenderCommands);
+
+    mode = -1;
+    for (int i = 0; i < queue->count; i++) {
+        const RenderCommand* command = &queue->commands[i];
+        int commandMode = GetRenderMode(command->kind);
+        if (commandMode != mode) {
+            if (mode >= 0 && !queue->headless) {
+                rlEnd();
+            }
+            stats.batches++;
+            mode = commandMode;
+            if (!queue->headless) {
+                rlBegin(mode);
+            }
+        }
+
+        if (!queue->headless) {
+            // flushes rlgl's buffer when full and keeps the current rlBegin() going
+            rlCheckRenderBatchLimit(GetRenderVertexCount(command->kind));
+            EmitRenderCommand(command);
+        }
+    }
+    if (mode >= 0 && !queue->headless) {
+        rlEnd();
+    }
+
+    queue->stats = stats;
+    queue->count = 0;
+}
+
+void UnloadRenderQueue(RenderQueue* queue) {
+    MemFree(queue->commands);
+    *queue = (RenderQueue){0};
+}
@@ -0,0 +1,60 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <stdint.h>
+
+#include "raylib.h"
+
+// Screens push draw commands instead of calling raylib, FlushRenderQueue() sorts them by layer and
+// primitive and draws each run of the same primitive inside one rlBegin()/rlEnd(). Lower layers are drawn
+// first, inside a layer the order is only kept between commands of the same primitive.
+
+typedef enum {
+    RENDER_LINE=0,
+    RENDER_RECTANGLE_LINES,
+    RENDER_RECTANGLE,
+    RENDER_CUBE,
+} RenderKind;
+
+typedef struct {
+    uint32_t key;       // layer, then primitive mode
+    uint32_t order;     // submission order, keeps the sort stable
+    RenderKind kind;
+    Color color;
+    union {
+        struct {
+            Vector2 start;
+            Vector2 end;
+        } line;
+        Rectangle rect;
+        struct {
+            Vector3 position;
+            Vector3 size;
+        } cube;
+    };
+} RenderCommand;
+
+typedef struct {
+    int commands;
+    int batches;            // rlBegin()/rlEnd() pairs issued
+    int immediateBatches;   // primitive switches the same commands cost in submission order, as direct raylib calls
+} RenderQueueStats;
+
+typedef struct {
+    RenderCommand* commands;
+    int count;
+    int allocated;
+    bool headless;          // count commands and batches without touching the GPU
+    RenderQueueStats stats; // of the last flush
+} RenderQueue;
+
+void PushRenderLine(RenderQueue* queue, int layer, Vector2 start, Vector2 end, Color color);
+void PushRenderRectangleLines(RenderQueue* queue, int layer, Rectangle rect, Color color);
+void PushRenderRectangle(RenderQueue* queue, int layer, Rectangle rect, Color color);
+void PushRenderCube(RenderQueue* queue, int layer, Vector3 position, Vector3 size, Color color);
+
+// Sorts, draws and empties the queue
+void FlushRenderQueue(RenderQueue* queue);
+void UnloadRenderQueue(RenderQueue* queue);
+
+#endif /* RENDER_QUEUE_H */
@@ -6,9 +6,12 @@ struct screen_t_;
 typedef struct screen_t_
 {
     int name;
+    void (*prepare)();              // optional, main thread right before load, e.g. to draw from the random state
+    void (*load)();                 // optional, runs on a worker thread before init, no GPU calls and no
+                                    // raylib random state, the main thread may be using both
     void (*init)();
-    struct screen_t_ (*update)();
-    void (*draw)();
+    struct screen_t_ (*update)();   // one fixed simulation tick
+    void (*draw)(float alpha);      // alpha in [0; 1] is how far the frame is between the last two ticks
     void (*close)();
 } screen_t;
 
@@ -0,0 +1,252 @@
+#include "spatial_grid.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "profiler.h"
+
+#define GROW(ptr, count) ptr = MemRealloc(ptr, sizeof(*(ptr)) * (count))
+
+#define INITIAL_BUCKETS 256
+
+static int CellCoord(const SpatialGrid* grid, float v) {
+    return (int)floorf(v / grid->cellSize);
+}
+
+static int HashCell(const SpatialGrid* grid, int cx, int cy) {
+    unsigned int h = (unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u;
+    return h & (grid->bucketCount - 1);
+}
+
+static bool BoundsOverlap(Rectangle a, Rectangle b) {
+    return a.x <= b.x + b.width && b.x <= a.x + a.width && a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+static void ResetBuckets(SpatialGrid* grid, int bucketCount) {
+    grid->bucketCount = bucketCount;
+    GROW(grid->buckets, bucketCount);
+    memset(grid->buckets, 0xFF, sizeof(int) * bucketCount);
+}
+
+void InitSpatialGrid(SpatialGrid* grid, float cellSize) {
+    grid->cellSize = cellSize;
+    grid->objectCount = 0;
+    grid->freeObjectCount = 0;
+    for (int k = 0; k < SPATIAL_KIND_COUNT; k++) {
+        if (grid->lookup[k] != NULL) {
+            memset(grid->lookup[k], 0xFF, sizeof(int) * grid->lookupAllocated[k]);
+        }
+    }
+
+    ResetBuckets(grid, grid->bucketCount > 0 ? grid->bucketCount : INITIAL_BUCKETS);
+    grid->entryCount = 0;
+    grid->freeEntry = -1;
+    grid->liveEntries = 0;
+    grid->stamp = 0;
+    grid->hitCount = 0;
+}
+
+void UnloadSpatialGrid(SpatialGrid* grid) {
+    MemFree(grid->objects);
+    MemFree(grid->freeObjects);
+    for (int k = 0; k < SPATIAL_KIND_COUNT; k++) {
+        MemFree(grid->lookup[k]);
+    }
+    MemFree(grid->buckets);
+    MemFree(grid->entries);
+    MemFree(grid->hits);
+    *grid = (SpatialGrid){0};
+}
+
+static void LinkEntry(SpatialGrid* grid, int e) {
+    int bucket = HashCell(grid, grid->entries[e].cx, grid->entries[e].cy);
+    grid->entries[e].next = grid->buckets[bucket];
+    grid->buckets[bucket] = e;
+}
+
+// Keeps chains short: at most two entries per bucket on average
+static void Rehash(SpatialGrid* grid) {
+    ResetBuckets(grid, grid->bucketCount * 2);
+    for (int e = 0; e < grid->entryCount; e++) {
+        if (grid->entries[e].object >= 0) {
+            LinkEntry(grid, e);
+        }
+    }
+
+    // free entries were unlinked by the reset, rebuild their list
+    grid->freeEntry = -1;
+    for (int e = grid->entryCount - 1; e >= 0; e--) {
+        if (grid->entries[e].object < 0) {
+            grid->entries[e].next = grid->freeEntry;
+            grid->freeEntry = e;
+        }
+    }
+}
+
+static void AddEntry(SpatialGrid* grid, int cx, int cy, int object) {
+    int e = grid->freeEntry;
+    if (e >= 0) {
+        grid->freeEntry = grid->entries[e].next;
+    } else {
+        if (grid->entryCount == grid->entryAllocated) {
+            grid->entryAllocated = grid->entryAllocated == 0 ? 256 : grid->entryAllocated * 2;
+            GROW(grid->entries, grid->entryAllocated);
+        }
+        e = grid->entryCount++;
+    }
+
+    grid->entries[e] = (SpatialEntry){cx, cy, object, -1};
+    LinkEntry(grid, e);
+    grid->liveEntries++;
+
+    if (grid->liveEntries > grid->bucketCount * 2) {
+        Rehash(grid);
+    }
+}
+
+static void RemoveEntry(SpatialGrid* grid, int cx, int cy, int object) {
+    int* link = &grid->buckets[HashCell(grid, cx, cy)];
+    while (*link >= 0) {
+        SpatialEntry* entry = &grid->entries[*link];
+        if (entry->object == object && entry->cx == cx && entry->cy == cy) {
+            int e = *link;
+            *link = entry->next;
+            entry->object = -1;
+            entry->next = grid->freeEntry;
+            grid->freeEntry = e;
+            grid->liveEntries--;
+            return;
+        }
+        link = &entry->next;
+    }
+}
+
+static void LinkObject(SpatialGrid* grid, int object) {
+    Rectangle b = grid->objects[object].bounds;
+    for (int cy = CellCoord(grid, b.y); cy <= CellCoord(grid, b.y + b.height); cy++) {
+        for (int cx = CellCoord(grid, b.x); cx <= CellCoord(grid, b.x + b.width); cx++) {
+            AddEntry(grid, cx, cy, object);
+        }
+    }
+}
+
+static void UnlinkObject(SpatialGrid* grid, int object) {
+    Rectangle b = grid->objects[object].bounds;
+    for (int cy = CellCoord(grid, b.y); cy <= CellCoord(grid, b.y + b.height); cy++) {
+        for (int cx = CellCoord(grid, b.x); cx <= CellCoord(grid, b.x + b.width); cx++) {
+            RemoveEntry(grid, cx, cy, object);
+        }
+    }
+}
+
+static int FindObject(const SpatialGrid* grid, SpatialKind kind, int id) {
+    if (id < 0 || id >= grid->lookupAllocated[kind]) {
+        return -1;
+    }
+
+    return grid->lookup[kind][id];
+}
+
+void InsertSpatial(SpatialGrid* grid, SpatialKind kind, int id, Rectangle bounds) {
+    if (FindObject(grid, kind, id) >= 0) {
+        MoveSpatial(grid, kind, id, bounds);
+        return;
+    }
+
+    if (id >= grid->lookupAllocated[kind]) {
+        int allocated = grid->lookupAllocated[kind] == 0 ? 64 : grid->lookupAllocated[kind];
+        while (allocated <= id) {
+            allocated *= 2;
+        }
+        GROW(grid->lookup[kind], allocated);
+        memset(&grid->lookup[kind][grid->lookupAllocated[kind]], 0xFF, sizeof(int) * (allocated - grid->lookupAllocated[kind]));
+        grid->lookupAllocated[kind] = allocated;
+    }
+
+    int object;
+    if (grid->freeObjectCount > 0) {
+        object = grid->freeObjects[--grid->freeObjectCount];
+    } else {
+        if (grid->objectCount == grid->objectAllocated) {
+            grid->objectAllocated = grid->objectAllocated == 0 ? 64 : grid->objectAllocated * 2;
+            GROW(grid->objects, grid->objectAllocated);
+            GROW(grid->freeObjects, grid->objectAllocated);
+        }
+        object = grid->objectCount++;
+    }
+
+    grid->objects[object] = (SpatialObject){bounds, kind, id, grid->stamp};
+    grid->lookup[kind][id] = object;
+    LinkObject(grid, object);
+}
+
+void RemoveSpatial(SpatialGrid* grid, SpatialKind kind, int id) {
+    int object = FindObject(grid, kind, id);
+    if (object < 0) {
+        return;
+    }
+
+    UnlinkObject(grid, object);
+    grid->lookup[kind][id] = -1;
+    grid->freeObjects[grid->freeObjectCount++] = object;
+}
+
+void MoveSpatial(SpatialGrid* grid, SpatialKind kind, int id, Rectangle bounds) {
+    int object = FindObject(grid, kind, id);
+    if (object < 0) {
+        InsertSpatial(grid, kind, id, bounds);
+        return;
+    }
+
+    Rectangle old = grid->objects[object].bounds;
+    bool sameCells = CellCoord(grid, old.x) == CellCoord(grid, bounds.x)
+        && CellCoord(grid, old.y) == CellCoord(grid, bounds.y)
+        && CellCoord(grid, old.x + old.width) == CellCoord(grid, bounds.x + bounds.width)
+        && CellCoord(grid, old.y + old.height) == CellCoord(grid, bounds.y + bounds.height);
+
+    if (!sameCells) {
+        UnlinkObject(grid, object);
+    }
+
+    grid->objects[object].bounds = bounds;
+
+    if (!sameCells) {
+        LinkObject(grid, object);
+    }
+}
+
+int QuerySpatial(SpatialGrid* grid, Rectangle area, unsigned kindMask) {
+    PROFILE_BEGIN("QuerySpatial");
+    grid->hitCount = 0;
+    grid->stamp++;
+
+    for (int cy = CellCoord(grid, area.y); cy <= CellCoord(grid, area.y + area.height); cy++) {
+        for (int cx = CellCoord(grid, area.x); cx <= CellCoord(grid, area.x + area.width); cx++) {
+            for (int e = grid->buckets[HashCell(grid, cx, cy)]; e >= 0; e = grid->entries[e].next) {
+                SpatialEntry entry = grid->entries[e];
+                if (entry.cx != cx || entry.cy != cy) {
+                    continue;
+                }
+
+                SpatialObject* object = &grid->objects[entry.object];
+                if (object->stamp == grid->stamp || !(kindMask & SPATIAL_MASK(object->kind))) {
+                    continue;
+                }
+
+                object->stamp = grid->stamp;
+                if (!BoundsOverlap(object->bounds, area)) {
+                    continue;
+                }
+
+                if (grid->hitCount == grid->hitAllocated) {
+                    grid->hitAllocated = grid->hitAllocated == 0 ? 64 : grid->hitAllocated * 2;
+                    GROW(grid->hits, grid->hitAllocated);
+                }
+                grid->hits[grid->hitCount++] = (SpatialHit){object->kind, object->id};
+            }
+        }
+    }
+
+    PROFILE_END();
+    return grid->hitCount;
+}
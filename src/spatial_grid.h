@@ -0,0 +1,70 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "raylib.h"
+
+typedef enum {
+    SPATIAL_PLATFORM=0,
+    SPATIAL_BUILDING,
+    SPATIAL_KIND_COUNT
+} SpatialKind;
+
+#define SPATIAL_MASK(kind) (1u << (kind))
+
+typedef struct {
+    SpatialKind kind;
+    int id;
+} SpatialHit;
+
+typedef struct {
+    Rectangle bounds;
+    SpatialKind kind;
+    int id;
+    int stamp;              // last query that reported the object, an object spans several cells
+} SpatialObject;
+
+typedef struct {
+    int cx;
+    int cy;
+    int object;
+    int next;               // next entry of the bucket chain, or of the free list
+} SpatialEntry;
+
+// Hashed uniform grid, unbounded. Objects are addressed by the caller's (kind, id) pair.
+typedef struct {
+    float cellSize;
+
+    SpatialObject* objects;
+    int objectCount;
+    int objectAllocated;
+    int* freeObjects;
+    int freeObjectCount;
+
+    int* lookup[SPATIAL_KIND_COUNT];    // id -> object, -1 if not in the grid
+    int lookupAllocated[SPATIAL_KIND_COUNT];
+
+    int* buckets;           // head entry of each chain, -1 if empty
+    int bucketCount;        // power of two
+    SpatialEntry* entries;
+    int entryCount;         // high-water mark of entries
+    int entryAllocated;
+    int freeEntry;
+    int liveEntries;
+
+    int stamp;
+    SpatialHit* hits;       // results of the last query
+    int hitCount;
+    int hitAllocated;
+} SpatialGrid;
+
+void InitSpatialGrid(SpatialGrid* grid, float cellSize);
+void UnloadSpatialGrid(SpatialGrid* grid);
+
+void InsertSpatial(SpatialGrid* grid, SpatialKind kind, int id, Rectangle bounds);
+void RemoveSpatial(SpatialGrid* grid, SpatialKind kind, int id);
+void MoveSpatial(SpatialGrid* grid, SpatialKind kind, int id, Rectangle bounds);
+
+// Objects of the masked kinds whose bounds touch the area, touching edges count. Results are in grid->hits.
+int QuerySpatial(SpatialGrid* grid, Rectangle area, unsigned kindMask);
+
+#endif /* SPATIAL_GRID_H */
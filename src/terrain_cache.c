@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #include <direct.h>
+    #define MakeCacheDirectory(path) _mkdir(path)
+#else
+    #include <sys/stat.h>
+    #define MakeCacheDirectory(path) mkdir(path, 0755)
+#endif
+
+#if !defined(_WIN32) && !defined(PLATFORM_WEB)
+    #define TERRAIN_CACHE_MMAP
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#include "terrain_cache.h"
+
+// File layout, native byte order, every section right after the previous one:
+//   TerrainCacheHeader
+//   heightmap pixels    imageWidth * imageHeight * 4 bytes
+//   mesh vertices       vertexCount * 3 floats
+//   mesh normals        vertexCount * 3 floats
+//   mesh texcoords      vertexCount * 2 floats
+//   occupancy           cellCount bits, bit i of byte i / 8
+
+#define TERRAIN_CACHE_MAGIC     "ATTC"
+#define TERRAIN_CACHE_VERSION   1
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    int32_t imageWidth;
+    int32_t imageHeight;
+    int32_t vertexCount;
+    int32_t triangleCount;
+    int32_t cellCount;
+    int32_t reserved;
+} TerrainCacheHeader;
+
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+} CacheFile;
+
+// FNV-1a
+uint64_t HashTerrainParams(const void* params, int size) {
+    const unsigned char* bytes = params;
+    uint64_t hash = 14695981039346656037ull;
+    for (int i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static void GetCachePath(uint64_t key, char* path, int size) {
+    snprintf(path, size, "%s/terrain-%016llx.bin", TERRAIN_CACHE_DIR, (unsigned long long)key);
+}
+
+static size_t GetCacheSize(TerrainCacheHeader header) {
+    return sizeof(TerrainCacheHeader)
+        + (size_t)header.imageWidth * header.imageHeight * 4
+        + (size_t)header.vertexCount * 8 * sizeof(float)
+        + ((size_t)header.cellCount + 7) / 8;
+}
+
+static bool OpenCacheFile(const char* path, CacheFile* file) {
+#if defined(TERRAIN_CACHE_MMAP)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    *file = (CacheFile){ data, info.st_size };
+    return true;
+#else
+    if (!FileExists(path)) {
+        return false;
+    }
+
+    unsigned int size = 0;
+    unsigned char* data = LoadFileData(path, &size);
+    *file = (CacheFile){ data, size };
+    return data != NULL;
+#endif
+}
+
+static void CloseCacheFile(CacheFile file) {
+#if defined(TERRAIN_CACHE_MMAP)
+    munmap((void*)file.data, file.size);
+#else
+    UnloadFileData((unsigned char*)file.data);
+#endif
+}
+
+static void* CopySection(const unsigned char** cursor, size_t size) {
+    void* copy = MemAlloc(size);
+    memcpy(copy, *cursor, size);
+    *cursor += size;
+    return copy;
+}
+
+bool LoadTerrainCache(uint64_t key, int cellCount, TerrainCacheData* data) {
+    char path[256];
+    GetCachePath(key, path, sizeof(path));
+
+    CacheFile file;
+    if (!OpenCacheFile(path, &file)) {
+        return false;
+    }
+
+    TerrainCacheHeader header;
+    if (file.size < sizeof(header)) {
+        printf("Terrain cache %s is damaged, regenerating\n", path);
+        CloseCacheFile(file);
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+
+    if (memcmp(header.magic, TERRAIN_CACHE_MAGIC, 4) != 0 || header.version != TERRAIN_CACHE_VERSION
+        || header.key != key || header.cellCount != cellCount || header.imageWidth <= 0 || header.imageHeight <= 0
+        || header.vertexCount < 0 || GetCacheSize(header) != file.size) {
+        printf("Terrain cache %s is damaged, regenerating\n", path);
+        CloseCacheFile(file);
+        return false;
+    }
+
+    const unsigned char* cursor = file.data + sizeof(header);
+    *data = (TerrainCacheData){0};
+
+    data->heightmap = (Image){
+        .data = CopySection(&cursor, (size_t)header.imageWidth * header.imageHeight * 4),
+        .width = header.imageWidth,
+        .height = header.imageHeight,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    };
+
+    data->mesh.vertexCount = header.vertexCount;
+    data->mesh.triangleCount = header.triangleCount;
+    data->mesh.vertices = CopySection(&cursor, (size_t)header.vertexCount * 3 * sizeof(float));
+    data->mesh.normals = CopySection(&cursor, (size_t)header.vertexCount * 3 * sizeof(float));
+    data->mesh.texcoords = CopySection(&cursor, (size_t)header.vertexCount * 2 * sizeof(float));
+
+    data->cellCount = cellCount;
+    data->occupied = MemAlloc(cellCount * sizeof(bool));
+    for (int i = 0; i < cellCount; i++) {
+        data->occupied[i] = (cursor[i / 8] >> (i % 8)) & 1;
+    }
+
+    CloseCacheFile(file);
+    return true;
+}
+
+// Removes the oldest terrain files past TERRAIN_CACHE_MAX_FILES, never keep
+static void PruneTerrainCache(const char* keep) {
+    // GetDirectoryFiles() keeps the list in static memory, only the loading thread lists the cache
+    int count = 0;
+    char** names = GetDirectoryFiles(TERRAIN_CACHE_DIR, &count);
+    char paths[TERRAIN_CACHE_MAX_FILES * 4][256];
+    int pathCount = 0;
+    for (int i = 0; i < count && pathCount < TERRAIN_CACHE_MAX_FILES * 4; i++) {
+        if (strncmp(names[i], "terrain-", 8) == 0 && IsFileExtension(names[i], ".bin")) {
+            snprintf(paths[pathCount], sizeof(paths[pathCount]), "%s/%s", TERRAIN_CACHE_DIR, names[i]);
+            if (strcmp(paths[pathCount], keep) != 0) {
+                pathCount++;
+            }
+        }
+    }
+    ClearDirectoryFiles();
+
+    for (; pathCount >= TERRAIN_CACHE_MAX_FILES; pathCount--) {
+        int oldest = 0;
+        for (int i = 1; i < pathCount; i++) {
+            if (GetFileModTime(paths[i]) < GetFileModTime(paths[oldest])) {
+                oldest = i;
+            }
+        }
+        remove(paths[oldest]);
+        strcpy(paths[oldest], paths[pathCount - 1]);
+    }
+}
+
+bool SaveTerrainCache(uint64_t key, const TerrainCacheData* data) {
+    MakeCacheDirectory(TERRAIN_CACHE_DIR);
+
+    char path[256];
+    char tempPath[260];
+    GetCachePath(key, path, sizeof(path));
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    // written aside and renamed, so a crash never leaves a half written file under the real name
+    FILE* file = fopen(tempPath, "wb");
+    if (file == NULL) {
+        printf("Unable to write terrain cache %s\n", tempPath);
+        return false;
+    }
+
+    TerrainCacheHeader header = {
+        .magic = TERRAIN_CACHE_MAGIC,
+        .version = TERRAIN_CACHE_VERSION,
+        .key = key,
+        .imageWidth = data->heightmap.width,
+        .imageHeight = data->heightmap.height,
+        .vertexCount = data->mesh.vertexCount,
+        .triangleCount = data->mesh.triangleCount,
+        .cellCount = data->cellCount
+    };
+    fwrite(&header, sizeof(header), 1, file);
+
+    Color* pixels = LoadImageColors(data->heightmap);
+    fwrite(pixels, 4, (size_t)header.imageWidth * header.imageHeight, file);
+    UnloadImageColors(pixels);
+
+    fwrite(data->mesh.vertices, sizeof(float), (size_t)header.vertexCount * 3, file);
+    fwrite(data->mesh.normals, sizeof(float), (size_t)header.vertexCount * 3, file);
+    fwrite(data->mesh.texcoords, sizeof(float), (size_t)header.vertexCount * 2, file);
+
+    int byteCount = (data->cellCount + 7) / 8;
+    unsigned char* bits = MemAlloc(byteCount);
+    for (int i = 0; i < data->cellCount; i++) {
+        if (data->occupied[i]) {
+            bits[i / 8] |= 1 << (i % 8);
+        }
+    }
+    fwrite(bits, 1, byteCount, file);
+    MemFree(bits);
+
+    bool ok = ferror(file) == 0;
+    ok = fclose(file) == 0 && ok;
+    if (ok) {
+        remove(path);
+        ok = rename(tempPath, path) == 0;
+    }
+    if (ok) {
+        PruneTerrainCache(path);
+    } else {
+        printf("Unable to write terrain cache %s\n", path);
+        remove(tempPath);
+    }
+
+    return ok;
+}
@@ -0,0 +1,28 @@
+#ifndef TERRAIN_CACHE_H
+#define TERRAIN_CACHE_H
+
+#include <stdint.h>
+
+#include "raylib.h"
+
+#define TERRAIN_CACHE_DIR       "cache"
+#define TERRAIN_CACHE_MAX_FILES 8       // one per map seed, the least recently written go first
+
+// Everything the 3D screen derives from its generator parameters. Buffers are owned by the caller,
+// LoadTerrainCache() allocates them with MemAlloc so UnloadImage()/UnloadMesh() can free them.
+typedef struct {
+    Image heightmap;        // R8G8B8A8
+    Mesh mesh;              // vertices, normals and texcoords, not uploaded
+    bool* occupied;         // one per voxel
+    int cellCount;
+} TerrainCacheData;
+
+// Key of the cache file, params is a plain struct of every generator input including the seed.
+// Add a field to it whenever the generator changes, so old files stop matching.
+uint64_t HashTerrainParams(const void* params, int size);
+
+// Memory-maps TERRAIN_CACHE_DIR/terrain-<key>.bin when the platform can, false on a miss or a damaged file
+bool LoadTerrainCache(uint64_t key, int cellCount, TerrainCacheData* data);
+bool SaveTerrainCache(uint64_t key, const TerrainCacheData* data);
+
+#endif /* TERRAIN_CACHE_H */
@@ -0,0 +1,469 @@
+#include "terrain_lod.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "raymath.h"
+#include "rlgl.h"
+
+#include "const.h"
+
+#define NO_NODE 0xFF
+
+typedef struct {
+    int north;  // sample step of a coarser neighbour on each edge, 0 if there is none
+    int south;
+    int west;
+    int east;
+} EdgeSnap;
+
+Mesh GenMeshHeightmapData(Image heightmap, Vector3 size) {
+    #define GRAY_VALUE(c) ((c.r+c.g+c.b)/3)
+
+    Mesh mesh = { 0 };
+    int mapX = heightmap.width;
+    int mapZ = heightmap.height;
+    Color* pixels = LoadImageColors(heightmap);
+
+    mesh.triangleCount = (mapX-1)*(mapZ-1)*2;
+    mesh.vertexCount = mesh.triangleCount*3;
+    mesh.vertices = MemAlloc(mesh.vertexCount*3*sizeof(float));
+    mesh.normals = MemAlloc(mesh.vertexCount*3*sizeof(float));
+    mesh.texcoords = MemAlloc(mesh.vertexCount*2*sizeof(float));
+
+    Vector3 scaleFactor = { size.x/(mapX - 1), size.y/255.0f, size.z/(mapZ - 1) };
+    int v = 0;
+    int tc = 0;
+    for (int z = 0; z < mapZ-1; z++) {
+        for (int x = 0; x < mapX-1; x++) {
+            Vector3 corners[4] = {
+                { x*scaleFactor.x, GRAY_VALUE(pixels[x + z*mapX])*scaleFactor.y, z*scaleFactor.z },
+                { x*scaleFactor.x, GRAY_VALUE(pixels[x + (z + 1)*mapX])*scaleFactor.y, (z + 1)*scaleFactor.z },
+                { (x + 1)*scaleFactor.x, GRAY_VALUE(pixels[(x + 1) + z*mapX])*scaleFactor.y, z*scaleFactor.z },
+                { (x + 1)*scaleFactor.x, GRAY_VALUE(pixels[(x + 1) + (z + 1)*mapX])*scaleFactor.y, (z + 1)*scaleFactor.z },
+            };
+            Vector2 uvs[4] = {
+                { (float)x/(mapX - 1), (float)z/(mapZ - 1) },
+                { (float)x/(mapX - 1), (float)(z + 1)/(mapZ - 1) },
+                { (float)(x + 1)/(mapX - 1), (float)z/(mapZ - 1) },
+                { (float)(x + 1)/(mapX - 1), (float)(z + 1)/(mapZ - 1) },
+            };
+            const int order[6] = { 0, 1, 2, 2, 1, 3 };
+
+            for (int t = 0; t < 6; t += 3) {
+                Vector3 a = corners[order[t]];
+                Vector3 b = corners[order[t + 1]];
+                Vector3 c = corners[order[t + 2]];
+                Vector3 normal = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(b, a), Vector3Subtract(c, a)));
+
+                for (int n = 0; n < 3; n++) {
+                    Vector3 p = corners[order[t + n]];
+                    mesh.vertices[v] = p.x;
+                    mesh.vertices[v + 1] = p.y;
+                    mesh.vertices[v + 2] = p.z;
+                    mesh.normals[v] = normal.x;
+                    mesh.normals[v + 1] = normal.y;
+                    mesh.normals[v + 2] = normal.z;
+                    mesh.texcoords[tc] = uvs[order[t + n]].x;
+                    mesh.texcoords[tc + 1] = uvs[order[t + n]].y;
+                    v += 3;
+                    tc += 2;
+                }
+            }
+        }
+    }
+
+    UnloadImageColors(pixels);
+    return mesh;
+}
+
+static float HeightAt(const TerrainLod* terrain, int x, int z) {
+    return terrain->heights[z * terrain->width + x];
+}
+
+static int QuadsX(const TerrainLod* terrain) {
+    return terrain->width - 1;
+}
+
+static int QuadsZ(const TerrainLod* terrain) {
+    return terrain->length - 1;
+}
+
+static int NodeSize(const TerrainLod* terrain, int level) {
+    return terrain->leafSize << level;
+}
+
+static int NodesPerSide(const TerrainLod* terrain, int level) {
+    return terrain->rootSize / NodeSize(terrain, level);
+}
+
+static int NodeIndex(const TerrainLod* terrain, int level, int i, int j) {
+    return terrain->levelOffset[level] + j * NodesPerSide(terrain, level) + i;
+}
+
+static bool NodeInsideMap(const TerrainLod* terrain, int x, int z) {
+    return x < QuadsX(terrain) && z < QuadsZ(terrain);
+}
+
+// Max deviation of the full resolution samples from the surface drawn with the node's sample step
+static float NodeGeometricError(const TerrainLod* terrain, int level, int x0, int z0) {
+    int step = 1 << level;
+    int x1 = fmin(x0 + NodeSize(terrain, level), QuadsX(terrain));
+    int z1 = fmin(z0 + NodeSize(terrain, level), QuadsZ(terrain));
+    float error = 0;
+
+    for (int z = z0; z <= z1; z++) {
+        int gz = z0 + ((z - z0) / step) * step;
+        int gz1 = fmin(gz + step, z1);
+        float tz = gz1 > gz ? (float)(z - gz) / (gz1 - gz) : 0;
+
+        for (int x = x0; x <= x1; x++) {
+            int gx = x0 + ((x - x0) / step) * step;
+            int gx1 = fmin(gx + step, x1);
+            float tx = gx1 > gx ? (float)(x - gx) / (gx1 - gx) : 0;
+
+            float top = Lerp(HeightAt(terrain, gx, gz), HeightAt(terrain, gx1, gz), tx);
+            float bottom = Lerp(HeightAt(terrain, gx, gz1), HeightAt(terrain, gx1, gz1), tx);
+            float approx = Lerp(top, bottom, tz);
+            error = fmax(error, fabsf(HeightAt(terrain, x, z) - approx));
+        }
+    }
+
+    return error;
+}
+
+TerrainLod LoadTerrainLod(Image heightmap, Vector3 size, Vector3 position, int leafSize) {
+    TerrainLod terrain = {0};
+    terrain.width = heightmap.width;
+    terrain.length = heightmap.height;
+    terrain.leafSize = leafSize;
+    terrain.position = position;
+    terrain.scale = (Vector3){size.x / (terrain.width - 1), size.y / 255.0f, size.z / (terrain.length - 1)};
+
+    Color* pixels = LoadImageColors(heightmap);
+    terrain.heights = (float*)MemAlloc(sizeof(float) * terrain.width * terrain.length);
+    for (int i = 0; i < terrain.width * terrain.length; i++) {
+        float gray = (float)(pixels[i].r + pixels[i].g + pixels[i].b) / 3.0f;
+        terrain.heights[i] = gray * terrain.scale.y;
+    }
+    UnloadImageColors(pixels);
+
+    terrain.rootSize = leafSize;
+    terrain.levels = 1;
+    while (terrain.rootSize < fmax(QuadsX(&terrain), QuadsZ(&terrain)) && terrain.levels < TERRAIN_LOD_MAX_LEVELS) {
+        terrain.rootSize *= 2;
+        terrain.levels++;
+    }
+
+    int nodeCount = 0;
+    for (int level = 0; level < terrain.levels; level++) {
+        terrain.levelOffset[level] = nodeCount;
+        nodeCount += NodesPerSide(&terrain, level) * NodesPerSide(&terrain, level);
+    }
+
+    terrain.nodeError = (float*)MemAlloc(sizeof(float) * nodeCount);
+    terrain.nodeMinY = (float*)MemAlloc(sizeof(float) * nodeCount);
+    terrain.nodeMaxY = (float*)MemAlloc(sizeof(float) * nodeCount);
+
+    for (int level = 0; level < terrain.levels; level++) {
+        int side = NodesPerSide(&terrain, level);
+        int nodeSize = NodeSize(&terrain, level);
+
+        for (int j = 0; j < side; j++) {
+            for (int i = 0; i < side; i++) {
+                int idx = NodeIndex(&terrain, level, i, j);
+                int x0 = i * nodeSize;
+                int z0 = j * nodeSize;
+                if (!NodeInsideMap(&terrain, x0, z0)) {
+                    continue;
+                }
+
+                float minY = INFINITY;
+                float maxY = -INFINITY;
+                float error = 0;
+                if (level == 0) {
+                    int x1 = fmin(x0 + nodeSize, QuadsX(&terrain));
+                    int z1 = fmin(z0 + nodeSize, QuadsZ(&terrain));
+                    for (int z = z0; z <= z1; z++) {
+                        for (int x = x0; x <= x1; x++) {
+                            minY = fmin(minY, HeightAt(&terrain, x, z));
+                            maxY = fmax(maxY, HeightAt(&terrain, x, z));
+                        }
+                    }
+                } else {
+                    // children keep the error monotonic, so a parent never looks better than its children
+                    error = NodeGeometricError(&terrain, level, x0, z0);
+                    for (int c = 0; c < 4; c++) {
+                        int ci = i * 2 + (c & 1);
+                        int cj = j * 2 + (c >> 1);
+                        if (!NodeInsideMap(&terrain, ci * NodeSize(&terrain, level - 1), cj * NodeSize(&terrain, level - 1))) {
+                            continue;
+                        }
+
+                        int child = NodeIndex(&terrain, level - 1, ci, cj);
+                        minY = fmin(minY, terrain.nodeMinY[child]);
+                        maxY = fmax(maxY, terrain.nodeMaxY[child]);
+                        error = fmax(error, terrain.nodeError[child]);
+                    }
+                }
+
+                terrain.nodeError[idx] = error;
+                terrain.nodeMinY[idx] = minY;
+                terrain.nodeMaxY[idx] = maxY;
+            }
+        }
+    }
+
+    return terrain;
+}
+
+void UnloadTerrainLod(TerrainLod* terrain) {
+    MemFree(terrain->heights);
+    MemFree(terrain->nodeError);
+    MemFree(terrain->nodeMinY);
+    MemFree(terrain->nodeMaxY);
+    *terrain = (TerrainLod){0};
+}
+
+static void PushNode(TerrainLodSelection* selection, TerrainNode node) {
+    if (selection->count == selection->capacity) {
+        selection->capacity = selection->capacity == 0 ? 64 : selection->capacity * 2;
+        selection->nodes = (TerrainNode*)MemRealloc(selection->nodes, sizeof(TerrainNode) * selection->capacity);
+    }
+
+    selection->nodes[selection->count++] = node;
+}
+
+static bool NodeNeedsSplit(const TerrainLod* terrain, TerrainLodView view, int level, int i, int j) {
+    int nodeSize = NodeSize(terrain, level);
+    int idx = NodeIndex(terrain, level, i, j);
+    int x0 = i * nodeSize;
+    int z0 = j * nodeSize;
+
+    BoundingBox box = {
+        .min = {
+            terrain->position.x + x0 * terrain->scale.x,
+            terrain->position.y + terrain->nodeMinY[idx],
+            terrain->position.z + z0 * terrain->scale.z
+        },
+        .max = {
+            terrain->position.x + fmin(x0 + nodeSize, QuadsX(terrain)) * terrain->scale.x,
+            terrain->position.y + terrain->nodeMaxY[idx],
+            terrain->position.z + fmin(z0 + nodeSize, QuadsZ(terrain)) * terrain->scale.z
+        }
+    };
+
+    // distance from the camera to the closest point of the node
+    Vector3 closest = Vector3Min(Vector3Max(view.cameraPosition, box.min), box.max);
+    float distance = Vector3Distance(view.cameraPosition, closest);
+    if (distance < 0.0001f) {
+        return true;
+    }
+
+    float pixelsPerUnit = view.screenHeight / (2.0f * tanf(view.fovy * DEG2RAD / 2) * distance);
+    return terrain->nodeError[idx] * pixelsPerUnit > view.maxPixelError;
+}
+
+static void SelectNode(const TerrainLod* terrain, TerrainLodView view, TerrainLodSelection* selection, int level, int i, int j) {
+    if (!NodeInsideMap(terrain, i * NodeSize(terrain, level), j * NodeSize(terrain, level))) {
+        return;
+    }
+
+    if (level > 0 && NodeNeedsSplit(terrain, view, level, i, j)) {
+        for (int c = 0; c < 4; c++) {
+            SelectNode(terrain, view, selection, level - 1, i * 2 + (c & 1), j * 2 + (c >> 1));
+        }
+    } else {
+        PushNode(selection, (TerrainNode){i * NodeSize(terrain, level), j * NodeSize(terrain, level), level});
+    }
+}
+
+static int LevelAt(const TerrainLodSelection* selection, int cx, int cz) {
+    if (cx < 0 || cz < 0 || cx >= selection->levelMapSize || cz >= selection->levelMapSize) {
+        return NO_NODE;
+    }
+
+    return selection->levelMap[cz * selection->levelMapSize + cx];
+}
+
+static void MarkNode(const TerrainLod* terrain, TerrainLodSelection* selection, TerrainNode node) {
+    int cells = 1 << node.level;
+    int cx0 = node.x / terrain->leafSize;
+    int cz0 = node.z / terrain->leafSize;
+    for (int cz = cz0; cz < cz0 + cells; cz++) {
+        memset(&selection->levelMap[cz * selection->levelMapSize + cx0], node.level, cells);
+    }
+}
+
+// True if any node along the edges is more than one level finer
+static bool NodeHasFineNeighbour(const TerrainLod* terrain, const TerrainLodSelection* selection, TerrainNode node) {
+    int cells = 1 << node.level;
+    int cx0 = node.x / terrain->leafSize;
+    int cz0 = node.z / terrain->leafSize;
+    for (int k = 0; k < cells; k++) {
+        int neighbours[] = {
+            LevelAt(selection, cx0 - 1, cz0 + k),
+            LevelAt(selection, cx0 + cells, cz0 + k),
+            LevelAt(selection, cx0 + k, cz0 - 1),
+            LevelAt(selection, cx0 + k, cz0 + cells)
+        };
+
+        for (int n = 0; n < ARR_SIZE(neighbours); n++) {
+            if (neighbours[n] != NO_NODE && neighbours[n] < node.level - 1) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static int NodeTriangles(const TerrainLod* terrain, TerrainNode node) {
+    int step = 1 << node.level;
+    int size = NodeSize(terrain, node.level);
+    int quadsX = (fmin(node.x + size, QuadsX(terrain)) - node.x + step - 1) / step;
+    int quadsZ = (fmin(node.z + size, QuadsZ(terrain)) - node.z + step - 1) / step;
+    return quadsX * quadsZ * 2;
+}
+
+void SelectTerrainLod(const TerrainLod* terrain, TerrainLodView view, TerrainLodSelection* selection) {
+    int mapSize = terrain->rootSize / terrain->leafSize;
+    if (selection->levelMapSize != mapSize) {
+        selection->levelMap = (unsigned char*)MemRealloc(selection->levelMap, mapSize * mapSize);
+        selection->levelMapSize = mapSize;
+    }
+
+    selection->count = 0;
+    SelectNode(terrain, view, selection, terrain->levels - 1, 0, 0);
+
+    memset(selection->levelMap, NO_NODE, mapSize * mapSize);
+    for (int n = 0; n < selection->count; n++) {
+        MarkNode(terrain, selection, selection->nodes[n]);
+    }
+
+    // Keep neighbours within one level of each other, so every edge can be stitched to the
+    // coarser side by snapping the odd vertices onto its edge line
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int n = 0; n < selection->count; n++) {
+            TerrainNode node = selection->nodes[n];
+            if (node.level < 2 || !NodeHasFineNeighbour(terrain, selection, node)) {
+                continue;
+            }
+
+            int childSize = NodeSize(terrain, node.level - 1);
+            for (int c = 0; c < 4; c++) {
+                TerrainNode child = {node.x + (c & 1) * childSize, node.z + (c >> 1) * childSize, node.level - 1};
+                if (!NodeInsideMap(terrain, child.x, child.z)) {
+                    continue;
+                }
+
+                if (c == 0) {
+                    selection->nodes[n] = child;
+                } else {
+                    PushNode(selection, child);
+                }
+                MarkNode(terrain, selection, child);
+            }
+            changed = true;
+        }
+    }
+
+    selection->triangleCount = 0;
+    memset(selection->levelCounts, 0, sizeof(selection->levelCounts));
+    for (int n = 0; n < selection->count; n++) {
+        selection->triangleCount += NodeTriangles(terrain, selection->nodes[n]);
+        selection->levelCounts[selection->nodes[n].level]++;
+    }
+}
+
+void UnloadTerrainLodSelection(TerrainLodSelection* selection) {
+    MemFree(selection->nodes);
+    MemFree(selection->levelMap);
+    *selection = (TerrainLodSelection){0};
+}
+
+static int CoarseStep(const TerrainLod* terrain, const TerrainLodSelection* selection, TerrainNode node, int cx, int cz) {
+    int level = LevelAt(selection, cx, cz);
+    if (level == NO_NODE || level <= node.level) {
+        return 0;
+    }
+
+    return 1 << level;
+}
+
+// Height of a vertex on an edge shared with a coarser node: interpolated along that node's edge
+static float SnappedHeight(const TerrainLod* terrain, int x, int z, bool alongX, int coarseStep) {
+    int t = alongX ? x : z;
+    int a = (t / coarseStep) * coarseStep;
+    int b = fmin(a + coarseStep, alongX ? QuadsX(terrain) : QuadsZ(terrain));
+    if (t == a || b == a) {
+        return HeightAt(terrain, x, z);
+    }
+
+    float ha = alongX ? HeightAt(terrain, a, z) : HeightAt(terrain, x, a);
+    float hb = alongX ? HeightAt(terrain, b, z) : HeightAt(terrain, x, b);
+    return Lerp(ha, hb, (float)(t - a) / (b - a));
+}
+
+static void TerrainVertex(const TerrainLod* terrain, TerrainNode node, EdgeSnap snap, int x, int z) {
+    int size = NodeSize(terrain, node.level);
+    float height = HeightAt(terrain, x, z);
+
+    if (z == node.z && snap.north) {
+        height = SnappedHeight(terrain, x, z, true, snap.north);
+    } else if (z == node.z + size && snap.south) {
+        height = SnappedHeight(terrain, x, z, true, snap.south);
+    } else if (x == node.x && snap.west) {
+        height = SnappedHeight(terrain, x, z, false, snap.west);
+    } else if (x == node.x + size && snap.east) {
+        height = SnappedHeight(terrain, x, z, false, snap.east);
+    }
+
+    rlTexCoord2f((float)x / QuadsX(terrain), (float)z / QuadsZ(terrain));
+    rlVertex3f(terrain->position.x + x * terrain->scale.x, terrain->position.y + height, terrain->position.z + z * terrain->scale.z);
+}
+
+void DrawTerrainLod(const TerrainLod* terrain, const TerrainLodSelection* selection, Texture2D texture, Color tint) {
+    for (int n = 0; n < selection->count; n++) {
+        TerrainNode node = selection->nodes[n];
+        int step = 1 << node.level;
+        int size = NodeSize(terrain, node.level);
+        int x1 = fmin(node.x + size, QuadsX(terrain));
+        int z1 = fmin(node.z + size, QuadsZ(terrain));
+
+        int cells = 1 << node.level;
+        int cx0 = node.x / terrain->leafSize;
+        int cz0 = node.z / terrain->leafSize;
+        EdgeSnap snap = {
+            .north = CoarseStep(terrain, selection, node, cx0, cz0 - 1),
+            .south = CoarseStep(terrain, selection, node, cx0, cz0 + cells),
+            .west = CoarseStep(terrain, selection, node, cx0 - 1, cz0),
+            .east = CoarseStep(terrain, selection, node, cx0 + cells, cz0)
+        };
+
+        rlCheckRenderBatchLimit(NodeTriangles(terrain, node) * 3);
+        rlSetTexture(texture.id);
+        rlBegin(RL_TRIANGLES);
+            rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+
+            // same triangulation as GenMeshHeightmap()
+            for (int z = node.z; z < z1; z += step) {
+                int zn = fmin(z + step, z1);
+                for (int x = node.x; x < x1; x += step) {
+                    int xn = fmin(x + step, x1);
+
+                    TerrainVertex(terrain, node, snap, x, z);
+                    TerrainVertex(terrain, node, snap, x, zn);
+                    TerrainVertex(terrain, node, snap, xn, z);
+
+                    TerrainVertex(terrain, node, snap, xn, z);
+                    TerrainVertex(terrain, node, snap, x, zn);
+                    TerrainVertex(terrain, node, snap, xn, zn);
+                }
+            }
+        rlEnd();
+        rlSetTexture(0);
+    }
+}
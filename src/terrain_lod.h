@@ -0,0 +1,60 @@
+#ifndef TERRAIN_LOD_H
+#define TERRAIN_LOD_H
+
+#include "raylib.h"
+
+#define TERRAIN_LOD_MAX_LEVELS 16
+
+typedef struct {
+    int x;          // first quad covered by the node, in heightmap samples
+    int z;
+    int level;      // 0 is full resolution, every level doubles the sample step
+} TerrainNode;
+
+typedef struct {
+    float* heights;     // world space heights, width * length samples, row major
+    int width;          // samples along x
+    int length;         // samples along z
+    int leafSize;       // quads along a node edge, same for every level
+    int rootSize;       // quads along the root edge, leafSize << (levels - 1)
+    int levels;
+    int levelOffset[TERRAIN_LOD_MAX_LEVELS];
+    float* nodeError;   // max height deviation of the simplified node surface
+    float* nodeMinY;
+    float* nodeMaxY;
+    Vector3 position;   // world position of sample (0, 0)
+    Vector3 scale;      // world distance between samples on x and z, y is unused
+} TerrainLod;
+
+typedef struct {
+    Vector3 cameraPosition;
+    float fovy;             // vertical field of view, degrees
+    int screenHeight;       // pixels
+    float maxPixelError;    // split nodes whose error projects above this many pixels
+} TerrainLodView;
+
+typedef struct {
+    TerrainNode* nodes;
+    int count;
+    int capacity;
+    unsigned char* levelMap;    // level of the selected node covering each leaf cell
+    int levelMapSize;           // leaf cells along an edge of levelMap
+    int triangleCount;
+    int levelCounts[TERRAIN_LOD_MAX_LEVELS];
+} TerrainLodSelection;
+
+// GenMeshHeightmap() without the upload at the end, so it can run off the main thread.
+// Same vertex layout, UploadMesh() has to be called before drawing it.
+Mesh GenMeshHeightmapData(Image heightmap, Vector3 size);
+
+// Heights are sampled the same way as GenMeshHeightmap(), so the result lines up with that mesh
+TerrainLod LoadTerrainLod(Image heightmap, Vector3 size, Vector3 position, int leafSize);
+void UnloadTerrainLod(TerrainLod* terrain);
+
+// Headless: fills selection with the nodes to draw, no GPU calls
+void SelectTerrainLod(const TerrainLod* terrain, TerrainLodView view, TerrainLodSelection* selection);
+void UnloadTerrainLodSelection(TerrainLodSelection* selection);
+
+void DrawTerrainLod(const TerrainLod* terrain, const TerrainLodSelection* selection, Texture2D texture, Color tint);
+
+#endif /* TERRAIN_LOD_H */
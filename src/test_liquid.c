@@ -6,6 +6,7 @@
 #include "raymath.h"
 
 #include "const.h"
+#include "fluid.h"
 
 #define MAP_WIDTH   16
 #define MAP_HEIGTH  16
@@ -15,164 +16,26 @@
 #define STARTX      300
 #define STARTY      40
 
-typedef enum {
-    AIR=0,
-    GROUND,
-    WATER
-} BlockType;
-
-BlockType blocks[MAP_WIDTH+2][MAP_HEIGTH+2];
-float mass[MAP_WIDTH+2][MAP_HEIGTH+2];
-float new_mass[MAP_WIDTH+2][MAP_HEIGTH+2];
-
-//Water properties
-float MaxMass = 1.0f; //The normal, un-pressurized mass of a full water cell
-float MaxCompress = 0.1f; //How much excess water a cell can store, compared to the cell above it
-float MinMass = 0.0001f;  //Ignore cells that are almost dry
-float MinFlow = 0.1f;
-float MinDraw = 0.05f;
-float MaxSpeed = 4.0f;   //max units of water moved out of one block to another, per timestep
-
-float get_stable_state_b(float total_mass) {
-    if (total_mass <= 1) {
-        return 1.0f;
-    } else if (total_mass < 2 * MaxMass + MaxCompress) {
-        // if the top cell contains less than MaxMass units of water, the bottom cell will contain a proportionally smaller excess amount
-        return (MaxMass * MaxMass + total_mass * MaxCompress) / (MaxMass + MaxCompress);
-    } else {
-        return (total_mass + MaxCompress) / 2;
-    }
-}
-
-void simulate_compression() {
-    float flow = 0;
-    float remaining_mass;
-
-    for (int x = 1; x < MAP_WIDTH; x++) {
-        for (int y = 1; y < MAP_HEIGTH; y++) {
-            if (blocks[x][y] == GROUND) {
-                continue;
-            }
-
-            flow = 0;
-            remaining_mass = mass[x][y];
-            if (remaining_mass <= 0) {
-                continue;
-            }
-
-            // Below
-            if (blocks[x][y+1] != GROUND) {
-                flow = get_stable_state_b(remaining_mass + mass[x][y+1]) - mass[x][y+1];
-                if (flow > MinFlow) {
-                    flow *= 0.5;
-                }
-                flow = Clamp(flow, 0, fmin(MaxSpeed, remaining_mass));
-
-                // printf("[%d][%d](%.2f) -> [%d][%d](%.2f): %.2f\n", x, y, new_mass[x][y], x, y+1, new_mass[x][y+1], flow);
-                new_mass[x][y] -= flow;
-                new_mass[x][y+1] += flow;
-                remaining_mass -= flow;
-            }
-
-            if (remaining_mass <= 0) {
-                continue;
-            }
-            
-            // Left
-            if (blocks[x-1][y] != GROUND) {
-                // Equalize the amount of water in this block and it's neighbour
-                flow = (mass[x][y] - mass[x-1][y]) / 4;
-                if (flow > MinFlow) {
-                    flow *= 0.5;
-                }
-                flow = Clamp(flow, 0, remaining_mass);
-
-                // printf("[%d][%d](%.2f) -> [%d][%d](%.2f): %.2f\n", x, y, new_mass[x][y], x-1, y, new_mass[x-1][y], flow);
-                new_mass[x][y] -= flow;
-                new_mass[x-1][y] += flow;
-                remaining_mass -= flow;
-            }
-
-            if (remaining_mass <= 0) {
-                continue;
-            }
-
-            // Right
-            if (blocks[x+1][y] != GROUND) {
-                // Equalize the amount of water in this block and it's neighbour
-                flow = (mass[x][y] - mass[x+1][y]) / 4;
-                if (flow > MinFlow) {
-                    flow *= 0.5;
-                }
-                flow = Clamp(flow, 0, remaining_mass);
-
-                // printf("[%d][%d](%.2f) -> [%d][%d](%.2f): %.2f\n", x, y, new_mass[x][y], x+1, y, new_mass[x+1][y], flow);
-                new_mass[x][y] -= flow;
-                new_mass[x+1][y] += flow;
-                remaining_mass -= flow;
-            }
+// Gravity along +y in screen coordinates, softer than the 3D screen's water
+#define LIQUID_PARAMS (FluidParams){ .maxMass = 1.0f, .maxCompress = 0.1f, .minMass = 0.0001f, .minFlow = 0.1f, .maxSpeed = 4.0f }
 
-            if (remaining_mass <= 0) {
-                continue;
-            }
-
-            // Up. Only compressed water flows upwards.
-
-            if (blocks[x][y-1] != GROUND) {
-                flow = remaining_mass - get_stable_state_b(remaining_mass + mass[x][y-1]);
-                if (flow > MinFlow) {
-                    flow *= 0.5;
-                }
-
-                flow = Clamp(flow, 0, fmin(MaxSpeed, remaining_mass));
-
-                // printf("[%d][%d](%.2f) -> [%d][%d](%.2f): %.2f\n", x, y, new_mass[x][y], x, y-1, new_mass[x][y-1], flow);
-                new_mass[x][y] -= flow;
-                new_mass[x][y-1] += flow;
-                remaining_mass -= flow;
-            }
-        }
-    }
-
-    memcpy(&mass, &new_mass, sizeof(mass));
-
-    for (int x = 1; x < MAP_WIDTH; x++) {
-        for (int y = 1; y < MAP_HEIGTH; y++) {
-            if (blocks[x][y] == GROUND) {
-                continue;
-            }
+Fluid liquid;
 
-            if (mass[x][y] > MinMass) {
-                blocks[x][y] = WATER;
-            } else {
-                blocks[x][y] = AIR;
-            }
-        }
-    }
-
-    for (int x = 0; x < MAP_WIDTH + 2; x++){
-        mass[x][0] = 0;
-        mass[x][MAP_HEIGTH+1] = 0;
-    }
-
-    for (int y = 1; y < MAP_HEIGTH + 1; y++){
-        mass[0][y] = 0;
-        mass[MAP_WIDTH+1][y] = 0;
-    }
-}
+float MinDraw = 0.05f;
 
 void draw_map() {
     for (int x = 0; x < MAP_WIDTH + 2; x++) {
         for (int y = 0; y < MAP_HEIGTH + 2; y++) {
-            if (blocks[x][y] == AIR) {
+            int i = GetFluidIndex(&liquid, x, y, 0);
+            if (liquid.cells[i] == FLUID_EMPTY) {
                 continue;
             }
 
             Color color = BLUE;
-            if (blocks[x][y] == GROUND) {
+            if (liquid.cells[i] == FLUID_OCCUPIED) {
                 color = BROWN;
             } else {
-                color.a = 255 * Clamp(mass[x][y], 0, MaxMass);
+                color.a = 255 * Clamp(GetFluidMass(&liquid, i), 0, liquid.params.maxMass);
             }
 
             DrawRectangle(STARTX + x * CELL_WIDTH, STARTY + y * CELL_HEIGTH, CELL_WIDTH, CELL_HEIGTH, color);
@@ -181,25 +44,22 @@ void draw_map() {
 }
 
 void init_map() {
+    liquid = LoadFluid(2, (int[]){ MAP_WIDTH + 2, MAP_HEIGTH + 2 }, 1, 1, LIQUID_PARAMS);
+
     for (int x = 0; x < MAP_WIDTH + 2; x++){
-        blocks[x][MAP_HEIGTH+1] = GROUND;
-        blocks[x][MAP_HEIGTH] = GROUND;
+        liquid.cells[GetFluidIndex(&liquid, x, MAP_HEIGTH, 0)] = FLUID_OCCUPIED;
     }
 
     for (int y = 0; y < MAP_HEIGTH+2; y++) {
-        blocks[0][y] = GROUND;
-        blocks[MAP_WIDTH+1][y] = GROUND;
-        blocks[MAP_WIDTH][y] = GROUND;
+        liquid.cells[GetFluidIndex(&liquid, MAP_WIDTH, y, 0)] = FLUID_OCCUPIED;
     }
 
     for (int y = MAP_HEIGTH * 0.3; y < MAP_HEIGTH * 0.75; y++) {
-        blocks[MAP_WIDTH / 2][y] = GROUND;
-        blocks[MAP_WIDTH / 2 + 1][y] = GROUND;
+        liquid.cells[GetFluidIndex(&liquid, MAP_WIDTH / 2, y, 0)] = FLUID_OCCUPIED;
+        liquid.cells[GetFluidIndex(&liquid, MAP_WIDTH / 2 + 1, y, 0)] = FLUID_OCCUPIED;
     }
 
-    blocks[2][1] = WATER;
-    mass[2][1] = MaxMass;
-    new_mass[2][1] = MaxMass;
+    SetFluidMass(&liquid, GetFluidIndex(&liquid, 2, 1, 0), liquid.params.maxMass);
 }
 
 int main(int argc, char const *argv[]) {
@@ -215,7 +75,10 @@ int main(int argc, char const *argv[]) {
         game_ticks++;
         // if (game_ticks % 5 == 0) {
         if (1) {
-            simulate_compression();
+            if (IsKeyPressed(KEY_S)) {
+                SetFluidSolver(&liquid, liquid.solver == FLUID_SOLVER_PIPES ? FLUID_SOLVER_CELLULAR : FLUID_SOLVER_PIPES);
+            }
+            StepFluid(&liquid);
 
             if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
                 Vector2 pos = GetMousePosition();
@@ -223,13 +86,10 @@ int main(int argc, char const *argv[]) {
                 int cy = (pos.y - STARTY) / CELL_HEIGTH;
                 printf("click on [%d][%d]\n", cx, cy);
                 if (cx < MAP_WIDTH + 2 && cy < MAP_HEIGTH + 2 && cx > 0 && cy > 0) {
-                    BlockType type = blocks[cx][cy];
-                    printf("Is %s\n", type == WATER ? "water" : type == AIR ? "air" : "ground");
-                    if (type != GROUND) {
-                        blocks[cx][cy] = WATER;
-                        mass[cx][cy] = MaxMass;
-                        new_mass[cx][cy] = MaxMass;
-                    }
+                    int i = GetFluidIndex(&liquid, cx, cy, 0);
+                    FluidCell type = liquid.cells[i];
+                    printf("Is %s\n", type == FLUID_FILLED ? "water" : type == FLUID_EMPTY ? "air" : "ground");
+                    SetFluidMass(&liquid, i, liquid.params.maxMass);
                 } else {
                     printf("Is invalid\n");
                 }
@@ -241,10 +101,12 @@ int main(int argc, char const *argv[]) {
 
             draw_map();
 
+            DrawText(liquid.solver == FLUID_SOLVER_PIPES ? "pipes solver (S)" : "cellular solver (S)", 10, 42, 20, BLACK);
             DrawFPS(10, 10);
         EndDrawing();
     }
 
+    UnloadFluid(&liquid);
     CloseWindow();
 
     return 0;